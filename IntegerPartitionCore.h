@@ -0,0 +1,2736 @@
+//
+//  IntegerPartitionCore.h
+//  SimpleIntegerPartition
+//
+
+/** @file IntegerPartitionCore.h
+    @brief The partitions, policies and samplers of IntegerPartition.h, without the I/O and diagnostics
+ 
+    Includes neither <iostream> nor generators seeded at startup, so a translation unit which only samples pays for neither.
+    The Ferrers diagrams are declared here and defined in IntegerPartitionIO.h, the sampler reports are in IntegerPartitionDiagnostics.h,
+    and IntegerPartition.h includes all three.  The output operators only need <ostream> and stay here.
+ */
+
+#ifndef SimpleIntegerPartition_IntegerPartitionCore_h
+#define SimpleIntegerPartition_IntegerPartitionCore_h
+
+#include <string>
+#include <cmath>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <initializer_list>
+#include <type_traits>
+#include <stdexcept>
+#include <ostream>
+#include <sstream>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include <random>
+#include <chrono>
+
+namespace IP {
+    
+
+    /** @typedef ull is short for unsigned long long, the longest built-in integer type in the standard. */
+    typedef unsigned long long ull;
+    
+    /** The generator used when none is given, one per generator type shared by all translation units, seeded from the clock on first use.
+        @returns the generator of type URNG.
+     */
+    template<typename URNG>
+    URNG& DefaultGenerator() {
+        static URNG generator(static_cast<typename URNG::result_type>(std::chrono::system_clock::now().time_since_epoch().count()));
+        return generator;
+    }
+    
+#if defined(__SIZEOF_INT128__)
+    /** @typedef uint128 is the 128 bit unsigned integer of GCC and Clang, for sizes and sums beyond 2^64, e.g., IP::IntegerPartition< IP::Unrestricted<IP::uint128>, IP::uint128 >. */
+    __extension__ typedef unsigned __int128 uint128;
+    
+    /** The standard streams have no overload for 128 bit integers.
+        @returns the decimal digits of value.
+     */
+    inline std::string ToString(uint128 value) {
+        char digits[40];
+        char* first = digits + sizeof(digits);
+        do {
+            *--first = static_cast<char>('0' + static_cast<int>(value % 10));
+            value /= 10;
+        } while(value);
+        return std::string(first, digits + sizeof(digits));
+    }
+    
+    /** Output operator for 128 bit integers, used by the output of partitions with IndexType = uint128.  Outside namespace IP use IP::ToString or using IP::operator<<. */
+    inline std::ostream& operator<<(std::ostream& out, uint128 value) { return out << ToString(value); }
+    
+    /** Input operator for 128 bit integers, which reads the decimal digits written by operator<<, e.g., by TiltGrid::Load.
+        Sets failbit if there are no digits or the value does not fit in 128 bits.
+     */
+    inline std::istream& operator>>(std::istream& in, uint128& value) {
+        std::istream::sentry skip_whitespace(in);
+        if(!skip_whitespace) return in;
+        uint128 result = 0;
+        bool digits = false;
+        for(int c = in.peek(); c >= '0' && c <= '9'; c = in.peek()) {
+            const unsigned digit = static_cast<unsigned>(c - '0');
+            if(result > (~uint128(0) - digit)/10) {
+                in.setstate(std::ios_base::failbit);
+                return in;
+            }
+            result = 10*result + digit;
+            digits = true;
+            in.get();
+        }
+        if(digits)
+            value = result;
+        else
+            in.setstate(std::ios_base::failbit);
+        return in;
+    }
+#endif
+    
+    namespace detail {
+        
+        // With IP_CHECKED_ARITHMETIC defined, sums and products of part sizes and multiplicities throw std::overflow_error instead of wrapping around.
+        // The checks use the GCC and Clang builtins, which work for any integer type including unsigned __int128.
+        
+        /** @returns a+b. */
+        template<typename IndexType>
+        inline IndexType Add(IndexType a, IndexType b) {
+#ifdef IP_CHECKED_ARITHMETIC
+            IndexType result;
+            if(__builtin_add_overflow(a, b, &result)) throw std::overflow_error("IP: a sum of part sizes overflows IndexType");
+            return result;
+#else
+            return a+b;
+#endif
+        }
+        
+        /** @returns a*b. */
+        template<typename IndexType>
+        inline IndexType Multiply(IndexType a, IndexType b) {
+#ifdef IP_CHECKED_ARITHMETIC
+            IndexType result;
+            if(__builtin_mul_overflow(a, b, &result)) throw std::overflow_error("IP: a part size times its multiplicity overflows IndexType");
+            return result;
+#else
+            return a*b;
+#endif
+        }
+    }
+    
+    // Each policy may also provide inverse(n), the number of part sizes which are at most n, i.e., u^{-1}(n).
+    // Policies without one are inverted by a binary search, see IP::Inverse.
+    
+    template<typename IndexType=ull>
+    struct Unrestricted {
+        constexpr IndexType operator()(IndexType i) const { return i; };
+        constexpr IndexType inverse(IndexType n) const { return n; };
+    };
+
+    template<typename IndexType=ull>
+    struct Even {
+        constexpr IndexType operator()(IndexType i) const { return 2*i; };
+        constexpr IndexType inverse(IndexType n) const { return n/2; };
+    };
+    
+    template<typename IndexType=ull>
+    struct Odd {
+        constexpr IndexType operator()(IndexType i) const { return 2*i-1; };
+        constexpr IndexType inverse(IndexType n) const { return n/2 + n%2; };
+    };
+    
+    template<typename IndexType=ull>
+    struct Triangular {
+        constexpr IndexType operator()(IndexType i) const { return i*(i+1)/2; };
+        
+        IndexType inverse(IndexType n) const {
+            // Largest k with k(k+1)/2 <= n, i.e., floor((sqrt(8n+1)-1)/2), corrected for rounding in the square root.
+            IndexType k = static_cast<IndexType>((sqrtl(8.0L*n+1.0L)-1.0L)/2.0L);
+            while(k > 0 && (*this)(k) > n) --k;
+            while((*this)(k+1) <= n) ++k;
+            return k;
+        };
+    };
+    
+    template<typename IndexType=ull, ull J=1, ull M=1>
+    struct JmodM {
+        constexpr IndexType operator()(IndexType i) const { return M*(i-1)+J; };
+        constexpr IndexType inverse(IndexType n) const { return J==0 || n < J ? 0 : (n-J)/M + 1; };
+    };
+    
+    
+    /** Compile-time description of a policy U, used by ExpectedSum and the random generation functions to pick a specialised loop over the part sizes.
+     
+        The primary template assumes nothing: the part sizes are found by calling u(1), u(2), ... until u(k) exceeds the target or returns 0.
+        Specialise it for your own policy when more is known, e.g., for partitions into parts <= 10,
+     
+        @code
+        struct MaxPartSize { ull operator()(ull i) const { return i<=10 ? i : 0; } };
+        namespace IP { template<> struct PolicyTraits<MaxPartSize> : PolicyTraits<void> {
+            static constexpr bool is_finite = true;
+            static constexpr ull size = 10;
+        }; }
+        @endcode
+     
+        is_arithmetic_progression: u(i) = first + stride*(i-1), so the loop is a counted loop of inverse(n) iterations which does not call u at all. \n
+        is_finite: only u(1),...,u(size) are part sizes, which bounds the binary search in IP::Inverse. \n
+        density_exponent, density: the number of part sizes <= y is about density*y^density_exponent, which gives xsolvebisection its initial guess.
+        An exponent of 0 means unknown, and the solver fits one to a sample of u(k).
+     */
+    template<typename U>
+    struct PolicyTraits {
+        static constexpr bool is_arithmetic_progression = false;
+        static constexpr bool is_finite = false;
+        static constexpr ull size = 0;
+        static constexpr double density_exponent = 0;
+        static constexpr double density = 0;
+    };
+    
+    /** Traits of the policy u(i) = first + stride*(i-1). */
+    template<typename IndexType, ull First, ull Stride>
+    struct ArithmeticProgressionTraits {
+        static constexpr bool is_arithmetic_progression = true;
+        static constexpr bool is_finite = false;
+        static constexpr ull size = 0;
+        static constexpr IndexType first = First;
+        static constexpr IndexType stride = Stride;
+        static constexpr double density_exponent = 1;
+        static constexpr double density = 1.0/Stride;
+        
+        /** @returns u^{-1}(n), the number of part sizes which are at most n. */
+        static constexpr IndexType inverse(IndexType n) { return n < first ? 0 : (n-first)/stride + 1; }
+    };
+    
+    template<typename IndexType>
+    struct PolicyTraits< Unrestricted<IndexType> > : ArithmeticProgressionTraits<IndexType,1,1> { };
+    
+    template<typename IndexType>
+    struct PolicyTraits< Even<IndexType> > : ArithmeticProgressionTraits<IndexType,2,2> { };
+    
+    template<typename IndexType>
+    struct PolicyTraits< Odd<IndexType> > : ArithmeticProgressionTraits<IndexType,1,2> { };
+    
+    /** About sqrt(2y) triangular numbers are at most y. */
+    template<typename IndexType>
+    struct PolicyTraits< Triangular<IndexType> > : PolicyTraits<void> {
+        static constexpr double density_exponent = 0.5;
+        static constexpr double density = 1.4142135623730950488;
+    };
+    
+    // J=0 would make u(1)=0, which is the end of the sequence, so it is left to the general loop.
+    template<typename IndexType, ull J, ull M>
+    struct PolicyTraits< JmodM<IndexType,J,M> > : std::conditional<J!=0, ArithmeticProgressionTraits<IndexType,J,M>, PolicyTraits<void> >::type { };
+    
+    
+    namespace detail {
+        
+        template<typename U, typename IndexType>
+        inline auto Inverse(U& u, IndexType n, int) -> decltype(static_cast<IndexType>(u.inverse(n))) {
+            return static_cast<IndexType>(u.inverse(n));
+        }
+        
+        /** Binary search for the largest k with 0 < u(k) <= n, relying on u(1), u(2), ... being increasing until it returns 0. */
+        template<typename U, typename IndexType>
+        IndexType Inverse(U& u, IndexType n, long) {
+            auto inside = [&](IndexType k) { IndexType i = u(k); return i != 0 && i <= n; };
+            
+            if(!inside(1)) return 0;
+            
+            // Find hi with u(hi) outside by doubling.  A decrease in u(k) is taken as the end of the sequence, which catches most overflows of IndexType near its maximum.
+            IndexType lo = 1, hi = 2;
+            if(PolicyTraits<U>::is_finite) {
+                hi = static_cast<IndexType>(PolicyTraits<U>::size) + 1;
+            }
+            else {
+                for(IndexType previous = u(lo); inside(hi) && u(hi) > previous; hi *= 2) {
+                    previous = u(hi);
+                    lo = hi;
+                }
+            }
+            
+            // Invariant: lo is inside and hi is not.
+            while(hi - lo > 1) {
+                IndexType mid = lo + (hi-lo)/2;
+                if(inside(mid) && u(mid) >= u(lo)) lo = mid;
+                else hi = mid;
+            }
+            return lo;
+        }
+        
+        template<bool ArithmeticProgression> using LoopKind = std::integral_constant<bool, ArithmeticProgression>;
+        typedef LoopKind<false> CountedLoop;
+        typedef LoopKind<true> ArithmeticProgressionLoop;
+        
+        template<typename U>
+        using LoopKindOf = LoopKind< PolicyTraits<U>::is_arithmetic_progression >;
+        
+        template<typename U, typename IndexType, typename Function>
+        inline void ForEachPart(U&, IndexType n, Function& f, ArithmeticProgressionLoop) {
+            typedef PolicyTraits<U> traits;
+            const IndexType count = traits::inverse(n);
+            IndexType i = traits::first;
+            for(IndexType k=0; k<count; ++k, i+=traits::stride)
+                f(i);
+        }
+        
+        template<typename U, typename IndexType, typename Function>
+        inline void ForEachPart(U& u, IndexType n, Function& f, CountedLoop) {
+            const IndexType count = Inverse(u, n, 0);
+            for(IndexType k=1; k<=count; ++k)
+                f(u(k));
+        }
+        
+        template<typename U, typename IndexType, typename Function>
+        inline void ForEachPartWhile(U&, IndexType n, Function& f, ArithmeticProgressionLoop) {
+            typedef PolicyTraits<U> traits;
+            const IndexType count = traits::inverse(n);
+            IndexType i = traits::first;
+            for(IndexType k=0; k<count && f(i); ++k, i+=traits::stride) { }
+        }
+        
+        template<typename U, typename IndexType, typename Function>
+        inline void ForEachPartWhile(U& u, IndexType n, Function& f, CountedLoop) {
+            const IndexType count = Inverse(u, n, 0);
+            for(IndexType k=1; k<=count && f(u(k)); ++k) { }
+        }
+    }
+    
+    /** Computes u^{-1}(n), the number of part sizes which are at most n, which is the trip count of every loop over the part sizes.
+        Uses the policy's own inverse(n) when it has one, and otherwise a binary search using O(log u^{-1}(n)) calls to u.
+     
+        @param u is the policy.
+        @param n is the largest part size of interest.
+        @returns the number of k with u(k) <= n.
+     */
+    template<typename U, typename IndexType>
+    inline IndexType Inverse(U& u, IndexType n) {
+        return detail::Inverse(u, n, 0);
+    }
+    
+    /** Calls f(i) for each part size i <= n allowed by the policy u, in increasing order, using the loop selected by PolicyTraits<U>.
+        @param u is the policy.
+        @param n is the largest part size of interest.
+        @param f is called once for each part size.
+     */
+    template<typename U, typename IndexType, typename Function>
+    inline void ForEachPart(U& u, IndexType n, Function&& f) {
+        detail::ForEachPart(u, n, f, detail::LoopKindOf<U>());
+    }
+    
+    /** Calls f(i) for the part sizes i <= n allowed by the policy u, in increasing order, until f returns false, e.g., once the terms of a convergent sum are negligible.
+        @param u is the policy.
+        @param n is the largest part size of interest.
+        @param f is called for each part size in turn and returns whether to go on.
+     */
+    template<typename U, typename IndexType, typename Function>
+    inline void ForEachPartWhile(U& u, IndexType n, Function&& f) {
+        detail::ForEachPartWhile(u, n, f, detail::LoopKindOf<U>());
+    }
+    
+    /** A set of allowable part sizes which is only known at run time, e.g., read in from a configuration file.
+        The part sizes are stored once in a sorted contiguous array which is shared by all copies of the policy, so copying is cheap and u(i) is a single array lookup.
+        Since the set is finite, u(i) returns 0 for all i larger than the number of part sizes.
+     
+        @code
+        IP::PartSetPartition ip;
+        ip.SetPolicy(IP::PartSet<>({1, 5, 10, 25}));
+        ip(100);
+        @endcode
+     */
+    template<typename IndexType=ull>
+    class PartSet {
+    public:
+        
+        /** The empty set of part sizes. */
+        PartSet() : PartSet(std::vector<IndexType>()) { }
+        
+        /** Creates the set from a list of part sizes in any order; duplicates and 0 are ignored. */
+        PartSet(std::initializer_list<IndexType> sizes) : PartSet(std::vector<IndexType>(sizes)) { }
+        
+        /** Creates the set from a range of part sizes in any order; duplicates and 0 are ignored. */
+        template<typename InputIterator>
+        PartSet(InputIterator first, InputIterator last) : PartSet(std::vector<IndexType>(first, last)) { }
+        
+        /** Creates the set from a list of part sizes in any order; duplicates and 0 are ignored. */
+        explicit PartSet(std::vector<IndexType> sizes) {
+            std::sort(sizes.begin(), sizes.end());
+            sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+            if(!sizes.empty() && sizes.front() == 0)
+                sizes.erase(sizes.begin());
+            
+            storage = std::make_shared<const std::vector<IndexType> >(std::move(sizes));
+        }
+        
+        /** Copies share the part sizes; a move is a copy, so that a moved from set is still the same set. */
+        PartSet(const PartSet&) = default;
+        PartSet& operator=(const PartSet&) = default;
+        
+        /** Creates the set from a bitmap, where bitmap[i] is true whenever i is an allowable part size. */
+        explicit PartSet(const std::vector<bool>& bitmap) : PartSet(FromBitmap(bitmap)) { }
+        
+        /** @returns the i-th smallest part size u_i, i=1,2,..., or 0 when i exceeds the number of part sizes. */
+        IndexType operator()(IndexType i) const { return (i-1) < storage->size() ? (*storage)[i-1] : 0; }
+        
+        /** @returns the number of part sizes which are at most n, in O(log size()) time. */
+        IndexType inverse(IndexType n) const { return static_cast<IndexType>(std::upper_bound(storage->begin(), storage->end(), n) - storage->begin()); }
+        
+        /** @returns true if part is an allowable part size, in O(log size()) time. */
+        bool Contains(IndexType part) const { return std::binary_search(storage->begin(), storage->end(), part); }
+        
+        /** @returns the number of allowable part sizes. */
+        size_t size() const { return storage->size(); }
+        
+    private:
+        
+        static std::vector<IndexType> FromBitmap(const std::vector<bool>& bitmap) {
+            std::vector<IndexType> sizes;
+            for(size_t i=1;i<bitmap.size();++i)
+                if(bitmap[i])
+                    sizes.push_back(static_cast<IndexType>(i));
+            return sizes;
+        }
+        
+        std::shared_ptr<const std::vector<IndexType> > storage;
+    };
+    
+    namespace detail {
+        
+        /** The samplers draw 64 random bits b per part size and use the uniform U = (b+1)/2^64 on (0,1], so that the event U <= p is exactly b < floor(p 2^64).
+            @param p is a probability.
+            @returns floor(p 2^64), saturated at 2^64-1 for p >= 1.
+         */
+        template<typename FloatingType>
+        std::uint64_t FixedPointThreshold(FloatingType p) {
+            if(!(p > 0)) return 0;
+            if(p >= 1) return ~std::uint64_t(0);
+            return static_cast<std::uint64_t>(std::ldexp(p, 64));
+        }
+        
+        /** @returns (bits+1)/2^64, never 0, so its log is finite. */
+        template<typename FloatingType>
+        FloatingType UniformFromBits(std::uint64_t bits) {
+            return std::ldexp((FloatingType)bits + (FloatingType)1.0, -64);
+        }
+        
+        /** @returns 1 - (bits+1)/2^64 = (2^64-1-bits)/2^64, computed without cancellation. */
+        template<typename FloatingType>
+        FloatingType ComplementFromBits(std::uint64_t bits) {
+            return std::ldexp((FloatingType)(~bits), -64);
+        }
+    }
+    
+    /** Multiplicity constraints, the optional fourth template parameter of IntegerPartition.
+     
+        In the Boltzmann model the multiplicity Z_i of part size i is independent of the others, with P(Z_i = k) proportional to x^(i k) over the allowed values of k.
+        Each constraint provides
+            Entry<KernelType>, the constants for one part size which a Sampler tabulates once per tilt;
+            Precompute<KernelType>(ilogx), which computes the Entry for part size i in the precision of ilogx = i*log(x) and rounds it to KernelType;
+            Sample(bits, entry), which transforms 64 uniform random bits into Z_i in KernelType;
+            Mean(xi), which is E[Z_i] where xi = x^i;
+            Variance(xi), which is Var[Z_i];
+            MeanAt(ilogx) and VarianceAt(ilogx), optionally, the same in terms of ilogx = i*log(x), using expm1 so that they keep their precision as x tends to 1; and
+            Admissible(k), whether a multiplicity of k is allowed, used by the deterministic second half.
+     
+        For most part sizes Z_i = 0, so every Entry holds threshold = floor(P(Z_i > 0) 2^64), and Sample returns 0 on the integer comparison bits >= threshold without any transcendental call.
+        Otherwise Z_i is computed by inversion of U = (bits+1)/2^64 and is at least 1, so the zero test is exact and the distribution is that of inversion of U.
+     */
+    
+    /** Any multiplicity is allowed, so Z_i is geometric.  This is the default. */
+    struct UnboundedMultiplicity {
+        
+        /** P(Z_i > 0) = x^i in fixed point, and 1/(i log x), so that the transformation is a multiplication instead of a multiplication and a division. */
+        template<typename KernelType>
+        struct Entry { std::uint64_t threshold; KernelType reciprocal; };
+        
+        template<typename KernelType, typename FloatingType>
+        static Entry<KernelType> Precompute(FloatingType ilogx) {
+            return Entry<KernelType>{ detail::FixedPointThreshold(std::exp(ilogx)), (KernelType)((FloatingType)1.0/ilogx) };
+        }
+        
+        template<typename MultiplicityType, typename KernelType>
+        static MultiplicityType Sample(std::uint64_t bits, const Entry<KernelType>& entry) {
+            if(bits >= entry.threshold) return 0;
+            // P(Z_i >= k) = x^(ik), so Z_i = floor( log(U) / (i log x) ), and U <= x^i here.
+            MultiplicityType value = static_cast<MultiplicityType>(std::floor(std::log(detail::UniformFromBits<KernelType>(bits))*entry.reciprocal));
+            return value > 1 ? value : 1;
+        }
+        
+        template<typename FloatingType>
+        static FloatingType Mean(FloatingType xi) { return xi/((FloatingType)1.0-xi); }
+        
+        template<typename FloatingType>
+        static FloatingType Variance(FloatingType xi) { return xi/(((FloatingType)1.0-xi)*((FloatingType)1.0-xi)); }
+        
+        /** x^i/(1-x^i) = 1/(e^{-i log x} - 1). */
+        template<typename FloatingType>
+        static FloatingType MeanAt(FloatingType ilogx) { return (FloatingType)1.0/std::expm1(-ilogx); }
+        
+        /** x^i/(1-x^i)^2 is the mean times one plus the mean. */
+        template<typename FloatingType>
+        static FloatingType VarianceAt(FloatingType ilogx) { FloatingType mean = MeanAt(ilogx); return mean*((FloatingType)1.0+mean); }
+        
+        template<typename MultiplicityType>
+        static bool Admissible(MultiplicityType) { return true; }
+    };
+    
+    /** Partitions into distinct parts: each part appears at most once, so Z_i is Bernoulli with P(Z_i=1) = x^i/(1+x^i). */
+    struct DistinctParts {
+        
+        /** P(Z_i=1) in fixed point, so that sampling is a single integer comparison. */
+        template<typename KernelType>
+        struct Entry { std::uint64_t threshold; };
+        
+        template<typename KernelType, typename FloatingType>
+        static Entry<KernelType> Precompute(FloatingType ilogx) {
+            FloatingType xi = std::exp(ilogx);
+            return Entry<KernelType>{ detail::FixedPointThreshold(xi/((FloatingType)1.0+xi)) };
+        }
+        
+        template<typename MultiplicityType, typename KernelType>
+        static MultiplicityType Sample(std::uint64_t bits, const Entry<KernelType>& entry) {
+            return bits < entry.threshold ? 1 : 0;
+        }
+        
+        template<typename FloatingType>
+        static FloatingType Mean(FloatingType xi) { return xi/((FloatingType)1.0+xi); }
+        
+        template<typename FloatingType>
+        static FloatingType Variance(FloatingType xi) { return xi/(((FloatingType)1.0+xi)*((FloatingType)1.0+xi)); }
+        
+        template<typename FloatingType>
+        static FloatingType MeanAt(FloatingType ilogx) { return (FloatingType)1.0/(std::exp(-ilogx)+(FloatingType)1.0); }
+        
+        template<typename FloatingType>
+        static FloatingType VarianceAt(FloatingType ilogx) { FloatingType p = MeanAt(ilogx); return p*((FloatingType)1.0-p); }
+        
+        template<typename MultiplicityType>
+        static bool Admissible(MultiplicityType k) { return k <= 1; }
+    };
+    
+    /** Each part appears at most K times, so Z_i is a geometric truncated to {0,1,...,K}, sampled by inversion. */
+    template<ull K>
+    struct BoundedMultiplicity {
+        
+        /** P(Z_i > 0) = (x^i - x^(i(K+1))) / (1 - x^(i(K+1))) in fixed point, 1/(i log x) and 1 - x^(i(K+1)). */
+        template<typename KernelType>
+        struct Entry { std::uint64_t threshold; KernelType reciprocal; KernelType tail; };
+        
+        template<typename KernelType, typename FloatingType>
+        static Entry<KernelType> Precompute(FloatingType ilogx) {
+            FloatingType tail = -std::expm1((FloatingType)(K+1)*ilogx);
+            FloatingType positive = (std::exp(ilogx) - std::exp((FloatingType)(K+1)*ilogx)) / tail;
+            return Entry<KernelType>{ detail::FixedPointThreshold(positive), (KernelType)((FloatingType)1.0/ilogx), (KernelType)tail };
+        }
+        
+        template<typename MultiplicityType, typename KernelType>
+        static MultiplicityType Sample(std::uint64_t bits, const Entry<KernelType>& entry) {
+            if(bits >= entry.threshold) return 0;
+            // P(Z_i >= k) = (x^(ik) - x^(i(K+1))) / (1 - x^(i(K+1))), so Z_i = floor( log(1 - (1-U)(1 - x^(i(K+1)))) / (i log x) ).
+            MultiplicityType value = static_cast<MultiplicityType>(std::floor(std::log1p(-detail::ComplementFromBits<KernelType>(bits)*entry.tail)*entry.reciprocal));
+            return value < 1 ? 1 : (value < K ? value : K);
+        }
+        
+        template<typename FloatingType>
+        static FloatingType Mean(FloatingType xi) {
+            FloatingType xK = std::pow(xi, (FloatingType)(K+1));
+            return xi/((FloatingType)1.0-xi) - (FloatingType)(K+1)*xK/((FloatingType)1.0-xK);
+        }
+        
+        template<typename FloatingType>
+        static FloatingType Variance(FloatingType xi) {
+            FloatingType xK = std::pow(xi, (FloatingType)(K+1));
+            return xi/(((FloatingType)1.0-xi)*((FloatingType)1.0-xi)) - (FloatingType)((K+1)*(K+1))*xK/(((FloatingType)1.0-xK)*((FloatingType)1.0-xK));
+        }
+        
+        /** The mean of the geometric at x^i less K+1 times that at x^(i(K+1)). */
+        template<typename FloatingType>
+        static FloatingType MeanAt(FloatingType ilogx) {
+            return UnboundedMultiplicity::MeanAt(ilogx) - (FloatingType)(K+1)*UnboundedMultiplicity::MeanAt((FloatingType)(K+1)*ilogx);
+        }
+        
+        template<typename FloatingType>
+        static FloatingType VarianceAt(FloatingType ilogx) {
+            return UnboundedMultiplicity::VarianceAt(ilogx) - (FloatingType)((K+1)*(K+1))*UnboundedMultiplicity::VarianceAt((FloatingType)(K+1)*ilogx);
+        }
+        
+        template<typename MultiplicityType>
+        static bool Admissible(MultiplicityType k) { return k <= K; }
+    };
+
+    
+    namespace detail {
+        
+        // The mean and variance of Z_i in terms of ilogx = i*log(x), from MeanAt and VarianceAt when the constraint has them, and otherwise from Mean and Variance at x^i.
+        
+        template<typename MultiplicityConstraint, typename FloatingType>
+        inline auto MeanAt(FloatingType ilogx, int) -> decltype(MultiplicityConstraint::MeanAt(ilogx)) {
+            return MultiplicityConstraint::MeanAt(ilogx);
+        }
+        
+        template<typename MultiplicityConstraint, typename FloatingType>
+        inline FloatingType MeanAt(FloatingType ilogx, long) {
+            return MultiplicityConstraint::Mean(std::exp(ilogx));
+        }
+        
+        template<typename MultiplicityConstraint, typename FloatingType>
+        inline auto VarianceAt(FloatingType ilogx, int) -> decltype(MultiplicityConstraint::VarianceAt(ilogx)) {
+            return MultiplicityConstraint::VarianceAt(ilogx);
+        }
+        
+        template<typename MultiplicityConstraint, typename FloatingType>
+        inline FloatingType VarianceAt(FloatingType ilogx, long) {
+            return MultiplicityConstraint::Variance(std::exp(ilogx));
+        }
+        
+        /** @returns E[Z_i] at ilogx = i*log(x). */
+        template<typename MultiplicityConstraint, typename FloatingType>
+        inline FloatingType MeanAt(FloatingType ilogx) { return MeanAt<MultiplicityConstraint>(ilogx, 0); }
+        
+        /** @returns Var[Z_i] at ilogx = i*log(x). */
+        template<typename MultiplicityConstraint, typename FloatingType>
+        inline FloatingType VarianceAt(FloatingType ilogx) { return VarianceAt<MultiplicityConstraint>(ilogx, 0); }
+    }
+    
+    template<typename U, typename IndexType=ull, typename MultiplicityType=IndexType, typename MultiplicityConstraint=UnboundedMultiplicity, typename FloatingType=long double, typename KernelType=FloatingType>
+    class Sampler;
+    
+    template<typename U, typename IndexType=ull, typename MultiplicityType=IndexType, typename MultiplicityConstraint=UnboundedMultiplicity, typename FloatingType=long double>
+    class SparseSampler;
+    
+    template<typename IndexType=ull, typename MultiplicityType=IndexType>
+    class PartitionPool;
+    
+    template<typename IndexType=ull, typename MultiplicityType=IndexType>
+    class PartitionBatch;
+    
+    template<typename U, typename IndexType=ull, typename MultiplicityType=IndexType, typename MultiplicityConstraint=UnboundedMultiplicity>
+    class IntegerPartition  {
+        
+    public:
+
+        // There is a noticeable lack of any constructors.  This is intentional to discourage anything other than default construction.
+        
+        /** Replaces the policy for which parts are allowed, e.g., a PartSet read in at run time.
+            @param policy is the new policy, used by all subsequent calls to the random generation functions.
+         */
+        void SetPolicy(const U& policy) { u = policy; }
+        
+        /** @returns the policy for which parts are allowed. */
+        const U& Policy() const { return u; }
+        
+        
+        /** Returns a multiset of parts, storing each part as a separate element.
+            Asymptotically there are sqrt(n) log(n) / c parts in a partition.
+            Asymptotically there are sqrt(n) differently sized parts in a partition.
+            Returning a large list of partitions as a multiset is slightly less efficient than our choice.
+         
+            @returns a multiset with parts in descending order.
+        */
+        template<typename PartsType = MultiplicityType>
+        std::multiset<PartsType, std::greater<PartsType> > AsMultiset() const {
+            
+            std::multiset<PartsType, std::greater<PartsType> > Parts;
+            auto it = Parts.begin();
+            
+            for(auto x : multiplicities) {
+                for(PartsType i=0, n=x.second;i<n; i++)
+                    it = Parts.insert(it, x.first );
+            }
+            
+            return Parts;
+        }
+        
+        /** Output operator, outputs parts one at a time from largest to smallest as a multiset
+            @param out is the output stream
+            @param ip is the integer partition object
+            @returns the output stream for overloading.
+         */
+        friend std::ostream& operator<<(std::ostream& out, const IntegerPartition& ip) {
+            
+            auto Parts = ip.AsMultiset();
+            for(auto x : Parts)
+                out << x << ",";
+            return out;
+            
+        }
+        
+        /** Prints out the Ferrers diagram of the partition, defined in IntegerPartitionIO.h
+            @param out is the output stream.
+        */
+        void Ferrer(std::ostream& out) const;
+        
+        /** Prints out the Ferrers diagram of the partition to std::cout, defined in IntegerPartitionIO.h */
+        void Ferrer() const;
+        
+        // Random Partition Functions that use O(n) algorithm
+        template<typename URNG= std::mt19937_64, typename FloatingType=long double>
+        void RandomSize(IndexType m, FloatingType manual_x=1, URNG& gen = DefaultGenerator<URNG>());
+ 
+        template<typename URNG= std::mt19937_64, typename FloatingType=long double>
+        void RejectionSampling(IndexType m, FloatingType manual_x=1, URNG& gen = DefaultGenerator<URNG>());
+        
+        template<typename URNG= std::mt19937_64, typename FloatingType=long double>
+        void PDCDeterministicSecondHalf(IndexType m, FloatingType manual_x=1, URNG& gen = DefaultGenerator<URNG>());
+        
+        template<typename URNG= std::mt19937_64, typename FloatingType=long double>
+        void operator()(IndexType m, FloatingType manual_x=1, URNG& gen = DefaultGenerator<URNG>());
+        
+        // Random partition of size m fitting inside a box, only for unrestricted parts and multiplicities
+        template<typename URNG= std::mt19937_64, typename FloatingType=long double>
+        void BoxSampling(IndexType m, IndexType max_parts, IndexType max_part, URNG& gen = DefaultGenerator<URNG>());
+        
+        /** Replaces the partition by its conjugate, whose parts are the column lengths of the Ferrers diagram, in O(number of distinct parts).
+            The j-th largest part of the conjugate is the number of parts >= j.
+            Note that the conjugate of a partition into parts from U is in general not a partition into parts from U.
+         */
+        void Conjugate() {
+            std::map<IndexType,MultiplicityType> conjugate;
+            ConjugateInto(conjugate);
+            multiplicities.swap(conjugate);
+        }
+        
+        /** Writes the conjugate of the partition into out, leaving this partition unchanged, in O(number of distinct parts).
+            out may have a different policy, e.g., an UnrestrictedPartition to hold the conjugate of an EvenPartition.
+            @param out is overwritten by the conjugate.
+         */
+        template<typename OtherU, typename OtherConstraint>
+        void Conjugate(IntegerPartition<OtherU,IndexType,MultiplicityType,OtherConstraint>& out) const {
+            if(static_cast<const void*>(&out) == static_cast<const void*>(this)) {
+                out.Conjugate();
+                return;
+            }
+            out.multiplicities.clear();
+            ConjugateInto(out.multiplicities);
+        }
+        
+        /** Calculates the weight of the partition.
+            @returns the weight of the partition
+        */
+        IndexType n() {
+            IndexType temp = 0;
+            
+            for(auto x : multiplicities) {
+                temp = detail::Add(temp, detail::Multiply(x.first, static_cast<IndexType>(x.second)));
+            }
+            
+            //for(IndexType i=1;i<multiplicities.size();i++)
+            //    temp += i*multiplicities[i];
+            
+            return temp;
+        }
+        
+    private:
+        
+        template<typename, typename, typename, typename> friend class IntegerPartition;
+        template<typename, typename, typename, typename, typename, typename> friend class Sampler;
+        template<typename, typename, typename, typename, typename> friend class SparseSampler;
+        template<typename, typename> friend class PartitionPool;
+        template<typename, typename> friend class PartitionBatch;
+        
+        /** Writes the conjugate of the multiplicities into an empty map, in O(number of distinct parts).
+            Going through the parts from largest to smallest, the conjugate has a part equal to the number of parts seen so far, repeated (difference to the next smaller part) times.
+            Those parts come out in increasing order, so each one is inserted at the end of the map.
+         */
+        void ConjugateInto(std::map<IndexType,MultiplicityType>& conjugate) const {
+            IndexType parts = 0;
+            IndexType previous = 0;
+            
+            for(auto rit = multiplicities.crbegin(); rit != multiplicities.crend(); ++rit) {
+                if(rit->second == 0) continue;
+                if(parts) conjugate.emplace_hint(conjugate.end(), parts, static_cast<MultiplicityType>(previous - rit->first));
+                parts += rit->second;
+                previous = rit->first;
+            }
+            if(parts) conjugate.emplace_hint(conjugate.end(), parts, static_cast<MultiplicityType>(previous));
+        }
+        
+        /** Replaces the partition, which must fit inside a k x l box, by its complement inside the box, in O(number of distinct parts).
+            A part v becomes l-v, and each of the k-(number of parts) empty rows becomes a part l.
+         */
+        void ComplementMultiplicities(IndexType k, IndexType l) {
+            std::map<IndexType,MultiplicityType> complement;
+            IndexType parts = 0;
+            
+            for(auto x : multiplicities) {
+                if(x.second == 0) continue;
+                parts += x.second;
+                if(x.first < l) complement.emplace_hint(complement.begin(), l - x.first, x.second);
+            }
+            if(parts < k) complement[l] += static_cast<MultiplicityType>(k - parts);
+            
+            multiplicities.swap(complement);
+        }
+        
+        /** @var multiplicities stores (i, c_i) pairs of elements. */
+        std::map<IndexType,MultiplicityType> multiplicities;
+        /** @var u sets the policy for which parts are allowed */
+        U u;
+    };
+    
+    
+    /**
+     Computes the value of x that solves ET = n
+     
+     @param n is the target value
+     @return 5 digits for n<200, and returns 1-c/sqrt(n) for n>201;
+     */
+    template<typename InputType, typename ReturnType=long double>
+    ReturnType findx(InputType n)
+    {
+        
+        ReturnType x1;
+        if(n>201)
+        {
+            const ReturnType pi = 3.1415926535897932384626433832;
+            x1 = 1.0-pi/sqrt(6.0)/sqrt(n);
+        }
+        else
+        {
+            ReturnType xx[201] = {0,0.5,0.54031,0.57202,0.59784,0.61942,0.63781,0.65374,0.6677,0.68009,0.69116,0.70114,0.7102,0.71847,0.72606,0.73306,0.73954,0.74555,0.75117,0.75641,0.76134,0.76597,0.77033,0.77445,0.77836,0.78206,0.78558,0.78892,0.79212,0.79516,0.79808,0.80087,0.80354,0.80611,0.80857,0.81094,0.81322,0.81542,0.81754,0.81959,0.82157,0.82348,0.82533,0.82712,0.82885,0.83054,0.83217,0.83375,0.83529,0.83679,0.83824,0.83966,0.84104,0.84238,0.84368,0.84496,0.8462,0.84741,0.8486,0.84975,0.85088,0.85198,0.85306,0.85411,0.85514,0.85615,0.85714,0.8581,0.85905,0.85998,0.86089,0.86178,0.86265,0.86351,0.86435,0.86517,0.86598,0.86677,0.86755,0.86832,0.86907,0.86981,0.87054,0.87125,0.87195,0.87264,0.87332,0.87399,0.87465,0.87529,0.87593,0.87656,0.87717,0.87778,0.87838,0.87897,0.87955,0.88012,0.88068,0.88124,0.88179,0.88233,0.88286,0.88339,0.8839,0.88442,0.88492,0.88542,0.88591,0.88639,0.88687,0.88734,0.88781,0.88827,0.88872,0.88917,0.88962,0.89005,0.89049,0.89091,0.89134,0.89175,0.89216,0.89257,0.89298,0.89337,0.89377,0.89416,0.89454,0.89492,0.8953,0.89567,0.89604,0.8964,0.89676,0.89712,0.89747,0.89782,0.89817,0.89851,0.89885,0.89918,0.89952,0.89984,0.90017,0.90049,0.90081,0.90113,0.90144,0.90175,0.90205,0.90236,0.90266,0.90296,0.90325,0.90354,0.90383,0.90412,0.90441,0.90469,0.90497,0.90524,0.90552,0.90579,0.90606,0.90633,0.90659,0.90685,0.90712,0.90737,0.90763,0.90788,0.90813,0.90838,0.90863,0.90888,0.90912,0.90936,0.9096,0.90984,0.91008,0.91031,0.91054,0.91077,0.911,0.91123,0.91145,0.91167,0.9119,0.91212,0.91233,0.91255,0.91276,0.91298,0.91319,0.9134,0.91361,0.91382,0.91402,0.91422,0.91443};
+            x1 = xx[(size_t)n];
+        }
+        return x1;
+    }
+    
+    
+    /** Runs task(c) for each chunk c = 0, ..., chunks-1 exactly once, possibly concurrently and in any order, and returns once all of them have,
+        rethrowing an exception thrown by one of them.  See SetSumExecutor, and ThreadPool in IntegerPartitionParallel.h.
+     */
+    typedef std::function<void(size_t chunks, const std::function<void(size_t)>& task)> ChunkExecutor;
+    
+    namespace detail {
+        
+        /** The executor of the sums over policies without an arithmetic progression, null to run the chunks in order on the calling thread,
+            together with the mutex which guards it.
+         */
+        struct SumExecutorSlot {
+            std::mutex mutex;
+            std::shared_ptr<const ChunkExecutor> executor;
+        };
+        
+        inline SumExecutorSlot& SumExecutors() {
+            static SumExecutorSlot slot;
+            return slot;
+        }
+        
+        /** @returns the current executor of the sums, which the caller keeps alive for the length of one sum, or null. */
+        inline std::shared_ptr<const ChunkExecutor> SumExecutor() {
+            SumExecutorSlot& slot = SumExecutors();
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            return slot.executor;
+        }
+    }
+    
+    /** Sets the executor of the sums over the part sizes of policies which are not arithmetic progressions, e.g., Triangular, PartSet and user
+        policies, in ExpectedSumLog, ExpectedSumLogDerivative and so in the tilt solve.  These sums always cut the part sizes into chunks of 2^14,
+        summed with Neumaier's compensated sum, and add the chunk sums in order up to the same last chunk, so the executor decides only where the
+        chunks run: the result is the same to the last bit with any executor or none, and installing one changes no other caller's results.
+        An empty executor, the default, runs the chunks in order on the calling thread.
+     
+        Policies whose operator() can be called on a const policy are shared by the chunks and must allow concurrent calls; others are copied for each chunk.
+        May be called from any thread; a sum which is running keeps the executor it started with.
+     
+        @param executor runs the chunks, e.g., a ThreadPool, see ParallelSums in IntegerPartitionParallel.h.
+     */
+    inline void SetSumExecutor(ChunkExecutor executor) {
+        std::shared_ptr<const ChunkExecutor> next;
+        if(executor)
+            next = std::make_shared<const ChunkExecutor>(std::move(executor));
+        detail::SumExecutorSlot& slot = detail::SumExecutors();
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        slot.executor.swap(next);
+    }
+    
+    
+    namespace detail {
+        
+        /** @returns the 10 point Gauss-Legendre rule for the integral of f over [a,b]. */
+        template<typename FloatingType, typename Function>
+        FloatingType GaussLegendre(Function& f, FloatingType a, FloatingType b) {
+            static const FloatingType nodes[5] = { 0.1488743389816312108848260L, 0.4333953941292471907992659L, 0.6794095682990244062343274L, 0.8650633666889845107320967L, 0.9739065285171717200779640L };
+            static const FloatingType weights[5] = { 0.2955242247147528701738930L, 0.2692667193099963550912269L, 0.2190863625159820439955349L, 0.1494513491505805931457763L, 0.0666713443086881375935688L };
+            FloatingType center = (a+b)/2, radius = (b-a)/2, sum = 0;
+            for(int j=0; j<5; ++j)
+                sum += weights[j]*(f(center - radius*nodes[j]) + f(center + radius*nodes[j]));
+            return radius*sum;
+        }
+        
+        /** Adaptive Gauss-Legendre, which halves [a,b] until the rule on the halves agrees with whole, the rule on [a,b], to within the
+            relative precision of FloatingType, or until depth halvings.
+            @param error is increased by the disagreement which remains.
+            @returns the integral of f over [a,b].
+         */
+        template<typename FloatingType, typename Function>
+        FloatingType Integrate(Function& f, FloatingType a, FloatingType b, FloatingType whole, FloatingType& error, int depth = 8) {
+            FloatingType middle = (a+b)/2;
+            FloatingType left = GaussLegendre(f, a, middle), right = GaussLegendre(f, middle, b);
+            FloatingType difference = std::fabs(left + right - whole);
+            if(difference <= 32*std::numeric_limits<FloatingType>::epsilon()*(std::fabs(left) + std::fabs(right)) || depth == 0) {
+                error += difference;
+                return left + right;
+            }
+            return Integrate(f, a, middle, left, error, depth-1) + Integrate(f, middle, b, right, error, depth-1);
+        }
+        
+        /** Sum of term(i) over the part sizes i <= n, one term at a time, which stops once i*t > cutoff and the terms are below the precision of the sum. */
+        template<typename U, typename IndexType, typename FloatingType, typename Term>
+        FloatingType ExactSum(U& u, IndexType n, FloatingType t, FloatingType cutoff, Term& term) {
+            
+            FloatingType res = 0;
+            
+            // Beyond i = cutoff/t the terms decrease at least geometrically with ratio x, so the rest of the sum is at most about 2 term/(1-x),
+            // and the loop stops once that is below the precision of the sum.  This makes the sum O(sqrt(n)) instead of O(n) for unrestricted parts.
+            const FloatingType tolerance = std::numeric_limits<FloatingType>::epsilon()*(-std::expm1(-t))/2;
+            
+            IP::ForEachPartWhile(u, n, [&](IndexType i) {
+                FloatingType value = term((FloatingType)i);
+                res += value;
+                return (FloatingType)i*t <= cutoff || value > tolerance*res;
+            });
+            
+            return res;
+        }
+        
+        /** Neumaier's compensated sum, whose rounding error does not grow with the number of terms. */
+        template<typename FloatingType>
+        struct CompensatedSum {
+            FloatingType sum, compensation;
+            
+            CompensatedSum() : sum(0), compensation(0) { }
+            
+            void Add(FloatingType value) {
+                FloatingType next = sum + value;
+                compensation += std::fabs(sum) >= std::fabs(value) ? (sum - next) + value : (value - next) + sum;
+                sum = next;
+            }
+            
+            FloatingType Value() const { return sum + compensation; }
+        };
+        
+        template<typename U, typename IndexType, typename = void>
+        struct HasConstCall : std::false_type { };
+        
+        template<typename U, typename IndexType>
+        struct HasConstCall<U, IndexType, decltype(void(std::declval<const U&>()(std::declval<IndexType>())))> : std::true_type { };
+        
+        /** ExactSum cut into chunks of 2^14 part sizes which executor runs, in waves of 1, 2, 4, ..., 64 chunks, or one chunk at a time on this thread
+            if executor is empty.  The chunks are compensated sums which are added in order, up to the first chunk whose last term is beyond the cutoff
+            and below the precision of the sum, or of the chunk itself, at which it stops, so the result depends on neither the executor nor the order and threads in which the chunks run.
+         */
+        template<typename U, typename IndexType, typename FloatingType, typename Term>
+        FloatingType ChunkedSum(U& u, IndexType n, FloatingType t, FloatingType cutoff, Term& term, const ChunkExecutor& executor) {
+            
+            // A chunk shares u if it can call it as const, and otherwise has its own copy.
+            typedef typename std::conditional<HasConstCall<U, IndexType>::value, const U&, U>::type ChunkPolicy;
+            
+            const IndexType count = Inverse(u, n, 0);
+            const IndexType chunk = IndexType(1) << 14;
+            const size_t wave_limit = 64;
+            const FloatingType tolerance = std::numeric_limits<FloatingType>::epsilon()*(-std::expm1(-t))/2;
+            
+            CompensatedSum<FloatingType> total;
+            std::vector< CompensatedSum<FloatingType> > sums;
+            std::vector<FloatingType> last_size(1), last_term(1);
+            std::vector<char> stopped(1);
+            FloatingType head = 0;
+            
+            // Part sizes u(done+1), ..., u(count) are left.
+            IndexType done = 0;
+            for(size_t wave = 1; done < count; wave = executor ? std::min(2*wave, wave_limit) : 1) {
+                
+                const IndexType left = count - done;
+                const size_t chunks = static_cast<size_t>(std::min<IndexType>(static_cast<IndexType>(wave), (left - 1)/chunk + 1));
+                sums.assign(chunks, CompensatedSum<FloatingType>());
+                last_size.resize(chunks);
+                last_term.resize(chunks);
+                stopped.assign(chunks, 0);
+                
+                const std::function<void(size_t)> task = [&](size_t c) {
+                    ChunkPolicy v = u;
+                    const IndexType first = done + static_cast<IndexType>(c)*chunk + 1;
+                    const IndexType last = first - 1 + std::min(chunk, count - (first - 1));
+                    FloatingType value = 0, i = 0;
+                    for(IndexType k=first; k<=last; ++k) {
+                        i = (FloatingType)v(k);
+                        value = term(i);
+                        sums[c].Add(value);
+                        // The terms are positive, so the first chunk, which is always a wave of its own, plus this chunk so far is a lower bound
+                        // on the total, and the chunk can stop as ExactSum does with a test which is the same whichever executor runs it.
+                        if(i*t > cutoff && value <= tolerance*(head + sums[c].Value())) {
+                            stopped[c] = 1;
+                            break;
+                        }
+                    }
+                    last_size[c] = i;
+                    last_term[c] = value;
+                };
+                if(executor)
+                    executor(chunks, task);
+                else
+                    task(0);
+                
+                for(size_t c=0; c<chunks; ++c) {
+                    total.Add(sums[c].sum);
+                    total.Add(sums[c].compensation);
+                    if(stopped[c] || (last_size[c]*t > cutoff && last_term[c] <= tolerance*total.Value()))
+                        return total.Value();
+                }
+                if(done == 0)
+                    head = total.Value();
+                done += std::min(left, static_cast<IndexType>(chunks)*chunk);
+            }
+            
+            return total.Value();
+        }
+        
+        template<typename U, typename IndexType, typename FloatingType, typename Term>
+        FloatingType SumOverParts(U& u, IndexType n, FloatingType t, FloatingType cutoff, Term& term, FloatingType, CountedLoop) {
+            std::shared_ptr<const ChunkExecutor> executor = SumExecutor();
+            return ChunkedSum(u, n, t, cutoff, term, executor ? *executor : ChunkExecutor());
+        }
+        
+        /** For u(k) = first + stride*(k-1) the terms are a smooth function g(k) = term(u(k)) which changes by a relative O(stride*t) from one k to the next,
+            so after the first head terms the sum is the integral of g plus Gregory's end corrections, the Euler-Maclaurin formula with the derivatives
+            replaced by finite differences,
+         
+                g(A) + ... + g(B) = int_A^B g + (g(A)+g(B))/2 + sum_m c_m (D_-^m g(B) + (-1)^m D_+^m g(A)),   c = 1/12, 1/24, 19/720, 3/160, 863/60480,
+         
+            which is exact for polynomials of degree 5.  The integral is over panels of width 1/t, up to where the integrand is below the precision of the sum,
+            so the whole sum takes a few hundred evaluations of term rather than about 40/t.
+            @param total is set to the sum if the estimated error, the last end correction plus the error of the quadrature, is within error.
+            @returns true if it is.
+         */
+        template<typename U, typename IndexType, typename FloatingType, typename Term>
+        bool GregorySum(U&, IndexType n, FloatingType t, FloatingType cutoff, Term& term, FloatingType error, IndexType head, FloatingType& total) {
+            
+            typedef PolicyTraits<U> traits;
+            const IndexType count = traits::inverse(n);
+            const FloatingType epsilon = std::numeric_limits<FloatingType>::epsilon();
+            
+            auto size = [&](IndexType k) { return (FloatingType)traits::first + (FloatingType)traits::stride*(FloatingType)(k-1); };
+            
+            FloatingType sum = 0;
+            for(IndexType k=1; k<=head; ++k)
+                sum += term(size(k));
+            
+            // The integral over the part sizes, in panels of width 1/t, until a panel beyond the cutoff is negligible or the part sizes end.
+            const IndexType A = head+1;
+            IndexType B = count;
+            FloatingType integral = 0, quadrature_error = 0;
+            FloatingType lo = size(A);
+            const FloatingType last = size(count);
+            while(lo < last) {
+                FloatingType hi = std::min(last, lo + 1/t);
+                FloatingType panel = Integrate(term, lo, hi, GaussLegendre(term, lo, hi), quadrature_error);
+                integral += panel;
+                lo = hi;
+                if(hi < last && hi*t > cutoff && std::fabs(panel) <= epsilon*std::fabs(sum + integral)) {
+                    // End at the first part size from hi on; the terms beyond it sum to less than the last panel.
+                    B = std::min(count, static_cast<IndexType>(std::ceil((hi - (FloatingType)traits::first)/(FloatingType)traits::stride)) + 1);
+                    FloatingType end = size(B);
+                    if(end > hi)
+                        integral += Integrate(term, hi, end, GaussLegendre(term, hi, end), quadrature_error);
+                    break;
+                }
+            }
+            if(B < A + 2*head)
+                return false;
+            
+            // Forward differences at A and backward differences at B, of orders 0 to 5.
+            FloatingType forward[6], backward[6];
+            for(int j=0; j<6; ++j) {
+                forward[j] = term(size(A + j));
+                backward[j] = term(size(B - j));
+            }
+            static const FloatingType gregory[5] = { 1.0L/12, 1.0L/24, 19.0L/720, 3.0L/160, 863.0L/60480 };
+            FloatingType corrections = (forward[0] + backward[0])/2, correction = 0;
+            for(int m=1; m<=5; ++m) {
+                for(int j=0; j<=5-m; ++j) {
+                    forward[j] = forward[j+1] - forward[j];
+                    backward[j] = backward[j] - backward[j+1];
+                }
+                correction = gregory[m-1]*(backward[0] + (m % 2 ? -forward[0] : forward[0]));
+                corrections += correction;
+            }
+            
+            // The integral is over part sizes, which are stride apart.
+            total = sum + integral/(FloatingType)traits::stride + corrections;
+            FloatingType allowed = error > 0 ? error : 64*epsilon*std::fabs(total);
+            return std::fabs(correction) + quadrature_error/(FloatingType)traits::stride <= allowed;
+        }
+        
+        /** GregorySum after 8, 64, 512, ... terms, since multiplicity constraints such as BoundedMultiplicity change the terms on a scale shorter
+            than 1/t near i = 0, until the head reaches i*t = 1.  Falls back on ExactSum when stride*t is not small or none of them is within error.
+         */
+        template<typename U, typename IndexType, typename FloatingType, typename Term>
+        FloatingType SumOverParts(U& u, IndexType n, FloatingType t, FloatingType cutoff, Term& term, FloatingType error, ArithmeticProgressionLoop) {
+            
+            typedef PolicyTraits<U> traits;
+            const IndexType count = traits::inverse(n);
+            const FloatingType stride = (FloatingType)traits::stride;
+            
+            if(error != 0 && stride*t <= (FloatingType)1/64) {
+                FloatingType total;
+                for(IndexType head = 8; 4*head <= count && (FloatingType)head*stride*t <= 1; head *= 8)
+                    if(GregorySum(u, n, t, cutoff, term, error, head, total))
+                        return total;
+            }
+            return ExactSum(u, n, t, cutoff, term);
+        }
+        
+        /** Sum of term(i) over the part sizes i <= n allowed by u, at log tilt t, for terms which decrease at least geometrically beyond i = cutoff/t.
+            For arithmetic progressions the tail is the Euler-Maclaurin approximation within error, absolute, or within the precision of FloatingType
+            if error < 0; error = 0 sums every term.
+         */
+        template<typename U, typename IndexType, typename FloatingType, typename Term>
+        FloatingType SumOverParts(U& u, IndexType n, FloatingType t, FloatingType cutoff, Term term, FloatingType error) {
+            return SumOverParts(u, n, t, cutoff, term, error, LoopKindOf<U>());
+        }
+    }
+    
+    /**
+     Returns $\sum_{i\in U} \frac{i e^{-it}}{1-e^{-it}} = \sum_{i\in U} \frac{i}{e^{it}-1}$, the expected size of a random partition with parts in $U$ of size $\leq n$
+     at the log tilt t = -log x.  For other multiplicity constraints the summand is i times the expected multiplicity, see detail::MeanAt.
+     
+     Each term is computed with expm1 from i*t, so it keeps the precision of ReturnType however close x = e^{-t} is to 1, whereas 1 - x^i loses the
+     digits of x which agree with 1.  This is what lets double solve for the tilt at sizes where x itself is within 10^-7 of 1.
+     
+     For arithmetic progressions, e.g., Unrestricted, Even, Odd and JmodM, only the first terms are summed one at a time and the rest is an
+     Euler-Maclaurin integral with end corrections, see detail::SumOverParts, so the cost no longer grows with n.  For other policies the terms
+     can be summed on several threads, see SetSumExecutor.
+     
+     @param t is the log tilt, -log x > 0.
+     @param n is the target.
+     @param u is the policy for the set U, copied since user policies need not have a const operator().
+     @param error is the absolute error allowed in the Euler-Maclaurin tail; by default the precision of ReturnType, and 0 sums every term.
+     @return expected value of the random partition.
+     */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType ExpectedSumLog(ReturnType t, IndexType n, U u, ReturnType error = -1)
+    {
+        return detail::SumOverParts(u, n, t, (ReturnType)1, [&](ReturnType i) { return i*detail::MeanAt<MultiplicityConstraint>(-i*t); }, error);
+    }
+    
+    /** ExpectedSumLog for a default constructed policy U. */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType ExpectedSumLog(ReturnType t, IndexType n)
+    {
+        return ExpectedSumLog<U,IndexType,ReturnType,MultiplicityConstraint>(t, n, U());
+    }
+    
+    /**
+     Returns the derivative of ExpectedSumLog in t, $-\sum_{i\in U} i^2 \mathrm{Var}[Z_i]$, which is minus the variance of the size of the random partition.
+     
+     @param t is the log tilt, -log x > 0.
+     @param n is the target.
+     @param u is the policy for the set U.
+     @param error is the absolute error allowed, see ExpectedSumLog.
+     @return the derivative of the expected size in t.
+     */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType ExpectedSumLogDerivative(ReturnType t, IndexType n, U u, ReturnType error = -1)
+    {
+        // i^2 Var[Z_i] decreases beyond i = 2/t.
+        return -detail::SumOverParts(u, n, t, (ReturnType)2, [&](ReturnType i) { return i*i*detail::VarianceAt<MultiplicityConstraint>(-i*t); }, error);
+    }
+    
+    /**
+     Returns $\sum_{i\in U} \frac{i x^i}{1-x^i}$, which is the expected size of a random partition with parts in $U$ of size $\leq n$ using parameter $x$.
+     For other multiplicity constraints the summand is i times the expected multiplicity, e.g., $\frac{i x^i}{1+x^i}$ for distinct parts.
+     Computed as ExpectedSumLog at t = -log x.
+     
+     @param x is the tilt.
+     @param n is the target.
+     @param u is the policy for the set U, copied since user policies need not have a const operator().
+     @return expected value of the random partition.
+     */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    long double ExpectedSum(ReturnType x, IndexType n, U u)
+    {
+        return ExpectedSumLog<U,IndexType,ReturnType,MultiplicityConstraint>(-std::log(x), n, u);
+    }
+    
+    /** ExpectedSum for a default constructed policy U. */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    long double ExpectedSum(ReturnType x, IndexType n)
+    {
+        return ExpectedSum<U,IndexType,ReturnType,MultiplicityConstraint>(x, n, U());
+    }
+    
+    /** How tsolve arrived at its log tilt, e.g., to check that it converged. */
+    template<typename FloatingType>
+    struct SolverReport {
+        /** @var t is the log tilt returned, -log x. */
+        FloatingType t = 0;
+        /** @var x is the tilt e^{-t}. */
+        FloatingType x = 0;
+        /** @var residual is ExpectedSumLog at t minus n. */
+        FloatingType residual = 0;
+        /** @var guess is the initial guess for t, from the asymptotic expected size, see detail::MeinardusGuess. */
+        FloatingType guess = 0;
+        /** @var exponent is the density exponent of the policy used for the guess, 0 if there was too little to fit one. */
+        FloatingType exponent = 0;
+        /** @var lower and upper bracket the root t once the solver is done; they are equal if no bracket was found. */
+        FloatingType lower = 0, upper = 0;
+        /** @var evaluations is the number of evaluations of ExpectedSumLog. */
+        size_t evaluations = 0;
+        /** @var iterations is the number of steps after the root was bracketed. */
+        size_t iterations = 0;
+        /** @var converged is false if the root is not bracketed for t in [10^-16, log 10], i.e., x in [0.1, 1-10^-16], or the solver ran out of iterations. */
+        bool converged = false;
+    };
+    
+    namespace detail {
+        
+        /** @returns the Riemann zeta function at s > 1, by Euler-Maclaurin summation after 10 terms, to about 1e-12. */
+        template<typename FloatingType>
+        FloatingType Zeta(FloatingType s) {
+            const FloatingType N = 10;
+            FloatingType sum = 0;
+            for(int k=1; k<10; ++k)
+                sum += std::pow((FloatingType)k, -s);
+            return sum + std::pow(N, 1-s)/(s-1) + std::pow(N, -s)/2 + s*std::pow(N, -s-1)/12
+                   - s*(s+1)*(s+2)*std::pow(N, -s-3)/720 + s*(s+1)*(s+2)*(s+3)*(s+4)*std::pow(N, -s-5)/30240;
+        }
+        
+        // The integral of z^a Mean(e^{-z}) over z > 0 for each multiplicity constraint, which sets the constant in the asymptotic expected size.
+        // Other constraints use that of unbounded multiplicities, which only costs the guess some accuracy.
+        
+        template<typename FloatingType, typename MultiplicityConstraint>
+        FloatingType MeanIntegral(FloatingType a, MultiplicityConstraint) {
+            return std::tgamma(a+1)*Zeta(a+1);
+        }
+        
+        template<typename FloatingType>
+        FloatingType MeanIntegral(FloatingType a, DistinctParts) {
+            return std::tgamma(a+1)*(1 - std::pow((FloatingType)2, -a))*Zeta(a+1);
+        }
+        
+        template<typename FloatingType, ull K>
+        FloatingType MeanIntegral(FloatingType a, BoundedMultiplicity<K>) {
+            return std::tgamma(a+1)*(1 - std::pow((FloatingType)(K+1), -a))*Zeta(a+1);
+        }
+        
+        /** Finds the density exponent a and density c with about c*y^a part sizes <= y, from PolicyTraits<U> or else
+            by least squares of log k against log u(k) for k = K, K/2, K/4, ..., 4, where K = u^{-1}(n).
+            @returns false if there are fewer than 16 part sizes up to n, or the fit is not increasing.
+         */
+        template<typename U, typename IndexType, typename FloatingType>
+        bool PolicyDensity(U& u, IndexType n, FloatingType& exponent, FloatingType& density) {
+            
+            const double known_exponent = PolicyTraits<U>::density_exponent;
+            if(known_exponent > 0) {
+                exponent = (FloatingType)known_exponent;
+                density = (FloatingType)PolicyTraits<U>::density;
+                return true;
+            }
+            
+            const IndexType count = IP::Inverse(u, n);
+            if(count < 16) return false;
+            
+            FloatingType sx = 0, sy = 0, sxx = 0, sxy = 0, points = 0;
+            for(IndexType k = count; k >= 4; k /= 2) {
+                FloatingType lx = std::log((FloatingType)u(k)), ly = std::log((FloatingType)k);
+                sx += lx; sy += ly; sxx += lx*lx; sxy += lx*ly; points += 1;
+            }
+            FloatingType slope = (points*sxy - sx*sy)/(points*sxx - sx*sx);
+            if(!(slope > 0) || !std::isfinite(slope)) return false;
+            
+            exponent = slope;
+            density = std::exp((sy - slope*sx)/points);
+            return true;
+        }
+        
+        /** Meinardus' asymptotic expected size: with about c*y^a part sizes <= y the expected size at x = e^{-t} is about
+            c a I(a) / t^{a+1}, where I(a) is MeanIntegral, so ExpectedSum = n at about t = (c a I(a) / n)^{1/(a+1)}.
+            @returns -log x of the guess, or 0 if the policy has no usable density, see PolicyDensity.
+         */
+        template<typename U, typename IndexType, typename FloatingType, typename MultiplicityConstraint>
+        FloatingType MeinardusGuess(U& u, IndexType n, FloatingType& exponent) {
+            FloatingType density = 0;
+            exponent = 0;
+            if(!PolicyDensity(u, n, exponent, density)) return 0;
+            return std::pow(density*exponent*MeanIntegral(exponent, MultiplicityConstraint())/(FloatingType)n, 1/(exponent+1));
+        }
+    }
+    
+    /**
+     Solves ExpectedSumLog(t,n) = n for the log tilt t = -log x.
+     
+     The search starts at the asymptotic solution for the density of the policy, see detail::MeinardusGuess, and widens a bracket around it
+     by steps predicted from the same asymptotics, so that custom and sparse policies get a bracket as tight as unrestricted partitions do.
+     The bracket is then closed by secant steps, falling back on bisection.  It stops once the residuals at the ends of the bracket are
+     within .00001 of each other, or within the rounding error of the sums, which is about epsilon*n.
+     
+     @param n is the target value.
+     @param u is the policy for the set U.
+     @param report is overwritten by the details of the solve, including whether it converged.
+     @return the log tilt t.  If the solver did not converge this is the evaluated point with the smallest residual.
+     */
+    template<typename U, typename IndexType=ull, typename ReturnType=long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType tsolve(IndexType n, const U& u, SolverReport<ReturnType>& report)
+    {
+        report = SolverReport<ReturnType>();
+        
+        U policy(u);
+        auto residual = [&](ReturnType t) {
+            ++report.evaluations;
+            return ExpectedSumLog<U,IndexType,ReturnType,MultiplicityConstraint>(t,n,policy) - (ReturnType)n;
+        };
+        auto finish = [&](ReturnType t, ReturnType r) {
+            report.t = t;
+            report.x = std::exp(-t);
+            report.residual = r;
+            return t;
+        };
+        
+        // The tilt stays within [0.1, 1 - 10^-16], as it always has.
+        const ReturnType tmin = (ReturnType)1e-16;
+        const ReturnType tmax = std::log((ReturnType)10);
+        const ReturnType tolerance = std::max((ReturnType).00001, 64*std::numeric_limits<ReturnType>::epsilon()*(ReturnType)n);
+        
+        ReturnType t = detail::MeinardusGuess<U,IndexType,ReturnType,MultiplicityConstraint>(policy, n, report.exponent);
+        ReturnType exponent = report.exponent;
+        if(!(t > 0)) {
+            // Too few part sizes to fit a density, so start from unrestricted partitions, whose expected size is above that of any restriction.
+            const ReturnType c = 1.2825498301618643;
+            t = c/std::sqrt((ReturnType)n);
+            exponent = 1;
+        }
+        ReturnType t0 = std::min(tmax, std::max(tmin, t));
+        report.guess = t0;
+        
+        // Step from t0 to where the asymptotics predict the root, E ~ t^{-(a+1)}, overshooting by a margin which grows on each step
+        // that fails to cross it, until the residual changes sign.
+        ReturnType r1 = residual(t0);
+        ReturnType tf = t0, r2 = r1;
+        ReturnType margin = 0.01;
+        while((r1 < 0) == (r2 < 0)) {
+            ReturnType ratio = std::pow(std::max(r2 + (ReturnType)n, (ReturnType)1)/(ReturnType)n, 1/(exponent+1));
+            ratio = std::min((ReturnType)2, std::max((ReturnType)0.5, ratio));
+            ReturnType next = tf*ratio*(r2 < 0 ? 1-margin : 1+margin);
+            next = std::min(tmax, std::max(tmin, next));
+            if(next == tf) break;
+            t0 = tf;
+            r1 = r2;
+            tf = next;
+            r2 = residual(tf);
+            margin *= 2;
+        }
+        
+        if((r1 < 0) == (r2 < 0)) {
+            // There is no root in [tmin, tmax], so return the end of the range closest to it.
+            report.lower = report.upper = tf;
+            return finish(tf, r2);
+        }
+        
+        // The residual decreases in t; the bracket keeps r1 < 0 <= r2, so t0 > tf.
+        if(r1 >= 0) {
+            std::swap(t0, tf);
+            std::swap(r1, r2);
+        }
+        
+        report.converged = true;
+        size_t max_iters = 1000;
+        
+        // Since the bracket is tight the residual is close to linear in it, so each step is the secant through the ends of the bracket,
+        // or a bisection if the secant leaves it.  When the same end moves twice in a row the residual used at the other end is halved,
+        // the Illinois rule, so that both ends close in.
+        ReturnType f1 = r1, f2 = r2;
+        int last = 0;
+        while(std::fabs(r1-r2) > tolerance)
+        {
+            if(report.iterations == max_iters) {
+                report.converged = false;
+                break;
+            }
+            ReturnType ti = t0 - f1*(tf-t0)/(f2-f1);
+            if(!(tf < ti && ti < t0))
+                ti = (t0+tf)/2;
+            // The bracket cannot shrink any further in ReturnType.
+            if(ti == t0 || ti == tf) break;
+            ReturnType r3 = residual(ti);
+            if(r3<0)
+            {
+                t0 = ti;
+                r1 = f1 = r3;
+                if(last < 0) f2 /= 2;
+                last = -1;
+            }
+            else
+            {
+                tf = ti;
+                r2 = f2 = r3;
+                if(last > 0) f1 /= 2;
+                last = 1;
+            }
+            ++report.iterations;
+        }
+        
+        report.lower = tf;
+        report.upper = t0;
+        return std::fabs(r2) <= std::fabs(r1) ? finish(tf, r2) : finish(t0, r1);
+    }
+    
+    /** tsolve without the report. */
+    template<typename U, typename IndexType=ull, typename ReturnType=long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType tsolve(IndexType n, const U& u)
+    {
+        SolverReport<ReturnType> report;
+        return tsolve<U,IndexType,ReturnType,MultiplicityConstraint>(n, u, report);
+    }
+    
+    /**
+     Solves ExpectedSum(x,n) = n for x, as e^{-t} for the t found by tsolve.
+     
+     @param n is the target value.
+     @param u is the policy for the set U.
+     @param report is overwritten by the details of the solve, including whether it converged.
+     @return the tilt x.
+     */
+    template<typename U, typename IndexType=ull, typename ReturnType=long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType xsolvebisection(IndexType n, const U& u, SolverReport<ReturnType>& report)
+    {
+        return std::exp(-tsolve<U,IndexType,ReturnType,MultiplicityConstraint>(n, u, report));
+    }
+    
+    /** xsolvebisection without the report. */
+    template<typename U, typename IndexType=ull, typename ReturnType=long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType xsolvebisection(IndexType n, const U& u)
+    {
+        SolverReport<ReturnType> report;
+        return xsolvebisection<U,IndexType,ReturnType,MultiplicityConstraint>(n, u, report);
+    }
+    
+    /** xsolvebisection for a default constructed policy U. */
+    template<typename U, typename IndexType=ull, typename ReturnType=long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType xsolvebisection(IndexType n)
+    {
+        return xsolvebisection<U,IndexType,ReturnType,MultiplicityConstraint>(n, U());
+    }
+    
+    
+    /** Finds the value of x when the parts have restrictions
+        @param n is the size of the partition
+        @param u is the policy for the set U
+        @returns the tilt x which solves ExpectedSum(x,n) = n, see tsolve
+    */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    long double findx(IndexType n, const U& u) {
+        return xsolvebisection<U,IndexType,ReturnType,MultiplicityConstraint>(n, u);
+    }
+    
+    /** findx for a default constructed policy U. */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    long double findx(IndexType n) {
+        return xsolvebisection<U,IndexType,ReturnType,MultiplicityConstraint>(n, U());
+    }
+    
+    /** Finds the log tilt t = -log x, which keeps its precision as x tends to 1, see tsolve.
+        @param n is the size of the partition
+        @param u is the policy for the set U
+        @returns the log tilt t which solves ExpectedSumLog(t,n) = n
+    */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType findt(IndexType n, const U& u) {
+        return tsolve<U,IndexType,ReturnType,MultiplicityConstraint>(n, u);
+    }
+    
+    /** findt for a default constructed policy U. */
+    template<typename U, typename IndexType=ull, typename ReturnType = long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    ReturnType findt(IndexType n) {
+        return tsolve<U,IndexType,ReturnType,MultiplicityConstraint>(n, U());
+    }
+
+    
+    
+    namespace detail {
+        
+        /** The largest multiplicity a constraint allows, or the largest ull if there is none; constraints defined by users are taken to have none. */
+        template<typename MultiplicityConstraint>
+        struct MultiplicityCap { static const ull value = ~ull(0); };
+        
+        template<>
+        struct MultiplicityCap<DistinctParts> { static const ull value = 1; };
+        
+        template<ull K>
+        struct MultiplicityCap< BoundedMultiplicity<K> > { static const ull value = K; };
+        
+        /** The acceptance rate and trial budget of the deterministic second half, shared by Sampler and SparseSampler.
+            The mean, variance and lattice span of the size N of the Boltzmann model give P(N = m) by the local limit theorem, once m is known to be
+            at most the largest size, the sum of u_i times the largest multiplicity over the part sizes, which is finite for distinct parts and
+            bounded multiplicities.
+         */
+        template<typename FloatingType>
+        struct Acceptance {
+            
+            /** Computes the moments of the size and the estimated acceptance rate.
+                The moment sums stop once their terms are negligible, so they take O(1/|log x|) terms rather than u^{-1}(m), and a few hundred for arithmetic progressions, see ExpectedSumLog.
+                @param u is the policy.
+                @param m is the size of the partitions.
+                @param logx is the log of the tilt.
+             */
+            template<typename MultiplicityConstraint, typename U, typename IndexType>
+            void Estimate(U& u, IndexType m, FloatingType logx) {
+                
+                // The moments of the size are the expected size and minus its derivative in t = -log x.
+                FloatingType mean = ExpectedSumLog<U,IndexType,FloatingType,MultiplicityConstraint>(-logx, m, u);
+                FloatingType variance = -ExpectedSumLogDerivative<U,IndexType,FloatingType,MultiplicityConstraint>(-logx, m, u);
+                
+                // The span is exact, but stops as soon as it is 1, and the largest size, which stops as soon as it reaches m.
+                const ull cap = MultiplicityCap<MultiplicityConstraint>::value;
+                IndexType span = 0;
+                IndexType reach = 0;
+                IP::ForEachPartWhile(u, m, [&](IndexType i) {
+                    IndexType a = span, b = i;
+                    while(b) { IndexType r = a % b; a = b; b = r; }
+                    span = a;
+                    if(reach < m)
+                        reach = (m - reach - 1)/i < cap ? m : reach + i*static_cast<IndexType>(cap);
+                    return span != 1 || reach < m;
+                });
+                
+                expected_size = mean;
+                deviation = std::sqrt(variance);
+                feasible = reach >= m && ((variance > 0) ? (m % span == 0) : (mean == (FloatingType)m));
+                
+                if(!feasible)
+                    rate = 0;
+                else if(variance <= 0)
+                    rate = 1;
+                else {
+                    // P(N = m) / P(Z_{u(1)} = 0), and P(Z_{u(1)} = 0) is the complement of the threshold of u(1).
+                    const FloatingType pi = 3.1415926535897932384626433832795L;
+                    FloatingType z = ((FloatingType)m - mean)/deviation;
+                    FloatingType positive = std::ldexp((FloatingType)MultiplicityConstraint::template Precompute<FloatingType>((FloatingType)u(1)*logx).threshold, -64);
+                    rate = std::min((FloatingType)1.0, (FloatingType)span*std::exp(-z*z/2)/(std::sqrt(2*pi)*deviation*((FloatingType)1.0-positive)));
+                }
+                
+                max_trials = static_cast<size_t>(std::min((FloatingType)1e8, std::max((FloatingType)1e4, 1000/rate)));
+            }
+            
+            FloatingType expected_size;
+            FloatingType deviation;
+            FloatingType rate;
+            bool feasible;
+            size_t max_trials;
+            size_t trials = 0;
+        };
+        
+        /** The deterministic second half, shared by Sampler and SparseSampler.
+            Calls fill(gen), which samples the multiplicities of all part sizes except u(1) and returns their total, until the remainder is accepted as the contribution of u(1).
+            @param acceptance holds the trial budget and counts the trials.
+            @param name is the name of the caller for error messages.
+            @returns the multiplicity of u(1).
+            @throws std::domain_error if there is no partition of size target, and std::runtime_error if the trial budget runs out.
+         */
+        template<typename MultiplicityConstraint, typename FloatingType, typename IndexType, typename Fill, typename URNG>
+        IndexType DeterministicSecondHalf(Acceptance<FloatingType>& acceptance, IndexType target, IndexType u1, FloatingType logx, Fill fill, URNG& gen, const char* name) {
+            
+            if(!acceptance.feasible) {
+                std::ostringstream message;
+                message << name << ": there is no partition of size " << target << " into the allowed parts";
+                throw std::domain_error(message.str());
+            }
+            
+            // Less than one chance in a thousand to finish within the budget, so do not start.
+            bool hopeless = acceptance.rate*(FloatingType)acceptance.max_trials < (FloatingType)1e-3;
+            
+            // Standard exponential, E = -log(uniform).
+            std::exponential_distribution<FloatingType> exponential;
+            const FloatingType neglogx = -logx;
+            
+            for(size_t attempt = 0; !hopeless && attempt < acceptance.max_trials; ++attempt) {
+                
+                ++acceptance.trials;
+                
+                // The multiplicity of u(1) is the deterministic second half, so it is not generated.
+                IndexType partial_total = fill(gen);
+                if(partial_total > target) continue;
+                
+                IndexType diff = target - partial_total;
+                
+                // Check the DSH condition.  P(Z_1 = diff/u(1)) is proportional to x^(u(1) diff/u(1)) = x^diff, and is largest at 0.
+                // Accepting when uniform <= x^diff is accepting when E >= diff*(-log x), which cannot underflow.
+                if( (diff%u1 == 0) && MultiplicityConstraint::Admissible(diff/u1) && (diff == 0 || exponential(gen) >= (FloatingType)diff*neglogx) )
+                    return diff/u1;
+            }
+            
+            std::ostringstream message;
+            if(hopeless)
+                message << name << ": a partition of size " << target << " is not expected within the budget of " << acceptance.max_trials << " trials";
+            else
+                message << name << ": no partition of size " << target << " accepted in " << acceptance.max_trials << " trials";
+            message << "; x = " << std::exp(logx) << ", expected size " << acceptance.expected_size << " with standard deviation " << acceptance.deviation
+                    << ", estimated acceptance rate " << acceptance.rate << " per trial";
+            throw std::runtime_error(message.str());
+        }
+    }
+    
+    
+    namespace detail {
+        
+        /** Receives the multiplicities of a trial of a Sampler, in increasing order of the part sizes, and keeps them in the map of an IntegerPartition. */
+        template<typename Map>
+        class MapSink {
+        public:
+            explicit MapSink(Map& map) : multiplicities(map) { }
+            
+            /** Discards the multiplicities of the previous trial. */
+            void Clear() { multiplicities.clear(); }
+            
+            /** Adds part size i, larger than all sizes added since Clear(), with multiplicity value > 0. */
+            template<typename IndexType, typename MultiplicityType>
+            void Append(IndexType i, MultiplicityType value) { multiplicities.emplace_hint(multiplicities.end(), i, value); }
+            
+            /** Adds part size i, smaller than all sizes added since Clear(), with multiplicity value > 0. */
+            template<typename IndexType, typename MultiplicityType>
+            void Prepend(IndexType i, MultiplicityType value) { multiplicities.emplace_hint(multiplicities.begin(), i, value); }
+            
+            /** Nothing to do, the map is the partition. */
+            void Commit() { }
+            
+        private:
+            Map& multiplicities;
+        };
+        
+        /** Receives the multiplicities of a trial of a Sampler as a new partition at the end of a PartitionBatch.
+            The partition only becomes part of the batch on Commit(), and is discarded if the sink goes out of scope before, e.g., when Draw throws.
+         */
+        template<typename Batch>
+        class BatchSink {
+        public:
+            explicit BatchSink(Batch& b) : batch(b), start(b.offsets.back()), committed(false) { }
+            
+            ~BatchSink() { if(!committed) Clear(); }
+            
+            void Clear() {
+                batch.parts.resize(start);
+                batch.multiplicities.resize(start);
+            }
+            
+            template<typename IndexType, typename MultiplicityType>
+            void Append(IndexType i, MultiplicityType value) {
+                batch.parts.push_back(i);
+                batch.multiplicities.push_back(value);
+            }
+            
+            template<typename IndexType, typename MultiplicityType>
+            void Prepend(IndexType i, MultiplicityType value) {
+                batch.parts.insert(batch.parts.begin() + start, i);
+                batch.multiplicities.insert(batch.multiplicities.begin() + start, value);
+            }
+            
+            void Commit() {
+                batch.offsets.push_back(batch.parts.size());
+                committed = true;
+            }
+            
+        private:
+            Batch& batch;
+            size_t start;
+            bool committed;
+        };
+    }
+    
+    
+    /**
+     Draws random integer partitions of a fixed size m over and over, doing all of the work which depends only on m once in the constructor.
+     The constructor solves for the tilt x and tabulates, for each of the u^{-1}(m) part sizes i, the constants of the multiplicity transformation, e.g., 1/(i log x).
+     Each draw then only generates random variables and transforms them, walking the table in order.
+     The table takes u^{-1}(m) entries of a 64 bit threshold and up to two KernelType each, plus the part sizes themselves unless U is an arithmetic progression.
+     
+     FloatingType is the precision of the tilt solve and of the table, and KernelType, which defaults to FloatingType, is the precision of the transformation in the hot loop.
+     The test for a zero multiplicity is exact in any precision, and rounding in the transformation only moves the boundaries between multiplicities 1, 2, ....
+     For unrestricted partitions of size m this changes a draw, compared with the same random bits in exact arithmetic, with probability at most about
+        float:       10^-4 for m = 10^2,  5*10^-3 for m = 10^4,  0.24 for m = 10^6;
+        double:      10^-11 for m = 10^4, 3*10^-9 for m = 10^7,  3*10^-5 for m = 10^12;
+        long double: 5*10^-15 for m = 10^4, 1.5*10^-12 for m = 10^7, 1.4*10^-8 for m = 10^12;
+     so double is adequate for any m which fits in memory and float only for small m.  bench/precision.cpp derives and checks these bounds.
+     
+     @code
+     IP::UnrestrictedPartition ip;
+     IP::Sampler< IP::Unrestricted<> > sampler(10000);
+     for(int i=0;i<1000;i++) {
+        sampler.Draw(ip, IP::DefaultGenerator<std::mt19937_64>());
+        // ... use ip
+     }
+     @endcode
+     
+     The same with the hot loop in double,
+     @code
+     IP::Sampler< IP::Unrestricted<>, IP::ull, IP::ull, IP::UnboundedMultiplicity, long double, double > sampler(10000);
+     @endcode
+     
+     Draws can also go straight into a PartitionBatch, without a map,
+     @code
+     IP::PartitionBatch<> batch;
+     for(int i=0;i<1000000;i++)
+        sampler.Draw(batch, IP::DefaultGenerator<std::mt19937_64>());
+     @endcode
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType, typename KernelType>
+    class Sampler {
+    public:
+        
+        typedef IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint> PartitionType;
+        
+        /** Solves for the tilt and precomputes the per-size constants.
+            @param m is the size of the partitions.
+            @param policy is the policy for which parts are allowed.
+            @param x_manual is the manually set value of x in cases of numerical instability; values >= 1 mean x is solved for.
+         */
+        explicit Sampler(IndexType m, const U& policy = U(), FloatingType x_manual = 1) : target(m), u(policy) {
+            if(x_manual < 1) {
+                solver.x = x_manual;
+                solver.t = -std::log(x_manual);
+                solver.converged = true;
+            }
+            // The log tilt is what the tables and the acceptance estimate need, and it is more precise than log(x).
+            logx = x_manual < 1 ? -solver.t : -tsolve<U,IndexType,FloatingType,MultiplicityConstraint>(m, u, solver);
+            x = std::exp(logx);
+            u1 = u(1);
+            
+            // P(Z_i > 0) decreases in i for any constraint, since it is 1 - 1/(sum of x^(ik) over the allowed k), so once its threshold is 0 it is 0
+            // for every larger size and the table stops, as in SparseSampler, e.g., after about 10^5 of the 10^7 sizes for unrestricted partitions of 10^7.
+            ForEachPartWhile(u, m, [&](IndexType i) {
+                Entry entry = MultiplicityConstraint::template Precompute<KernelType>((FloatingType)i*logx);
+                if(entry.threshold == 0) return false;
+                entries.push_back(entry);
+                if(!PolicyTraits<U>::is_arithmetic_progression)
+                    sizes.push_back(i);
+                return true;
+            });
+            count = static_cast<IndexType>(entries.size());
+            
+            acceptance.template Estimate<MultiplicityConstraint>(u, m, logx);
+        }
+        
+        /** Overwrites ip with a random partition of size m using PDC deterministic second half, see IntegerPartition::PDCDeterministicSecondHalf.
+            @throws std::domain_error if there is no partition of size m into the allowed parts, as far as the lattice of part sizes and the largest size show.
+            @throws std::runtime_error if no trial is accepted within MaxTrials() trials.
+         */
+        template<typename URNG>
+        void Draw(PartitionType& ip, URNG& gen) {
+            detail::MapSink< std::map<IndexType,MultiplicityType> > sink(ip.multiplicities);
+            DrawTo(sink, gen);
+        }
+        
+        /** Appends a random partition of size m to batch, see Draw. */
+        template<typename URNG>
+        void Draw(PartitionBatch<IndexType,MultiplicityType>& batch, URNG& gen) {
+            detail::BatchSink< PartitionBatch<IndexType,MultiplicityType> > sink(batch);
+            DrawTo(sink, gen);
+        }
+        
+        /** Overwrites ip with a random partition of random size using Fristedt's method, see IntegerPartition::RandomSize. */
+        template<typename URNG>
+        void DrawRandomSize(PartitionType& ip, URNG& gen) {
+            detail::MapSink< std::map<IndexType,MultiplicityType> > sink(ip.multiplicities);
+            Fill<false>(sink, gen);
+        }
+        
+        /** Appends a random partition of random size to batch, see DrawRandomSize. */
+        template<typename URNG>
+        void DrawRandomSize(PartitionBatch<IndexType,MultiplicityType>& batch, URNG& gen) {
+            detail::BatchSink< PartitionBatch<IndexType,MultiplicityType> > sink(batch);
+            Fill<false>(sink, gen);
+            sink.Commit();
+        }
+        
+        /** @returns the size m of the partitions drawn. */
+        IndexType m() const { return target; }
+        
+        /** @returns the tilt x. */
+        FloatingType tilt() const { return x; }
+        
+        /** @returns the log tilt t = -log x. */
+        FloatingType t() const { return -logx; }
+        
+        /** @returns how the tilt was solved for, e.g., whether the solver converged; only x, t and converged are set if x was given to the constructor. */
+        const SolverReport<FloatingType>& Solver() const { return solver; }
+        
+        /** @returns the number of part sizes generated in each trial, those of u(1), ..., u^{-1}(m) with P(Z_i > 0) >= 2^-64. */
+        IndexType PartSizes() const { return count; }
+        
+        /** @returns the acceptance rate of a trial of Draw, P(N = m)/P(Z_{u(1)} = 0) estimated by the local limit theorem for the size N. */
+        FloatingType AcceptanceRate() const { return acceptance.rate; }
+        
+        /** @returns the number of trials Draw makes before it gives up, by default 1000 times the expected number, but at least 10^4 and at most 10^8. */
+        size_t MaxTrials() const { return acceptance.max_trials; }
+        
+        /** @param trials is the number of trials Draw makes before it gives up. */
+        void SetMaxTrials(size_t trials) { acceptance.max_trials = trials; }
+        
+        /** @returns the total number of trials made by Draw so far, e.g., to report the observed acceptance rate. */
+        size_t Trials() const { return acceptance.trials; }
+        
+    private:
+        
+        /** Draws a partition of size m into sink and commits it. */
+        template<typename Sink, typename URNG>
+        void DrawTo(Sink& sink, URNG& gen);
+        
+        /** Samples the multiplicities of all part sizes up to m, except u(1) if SkipFirst, into sink, see detail::MapSink.
+            @returns the size of the partition generated.
+         */
+        template<bool SkipFirst, typename Sink, typename URNG>
+        IndexType Fill(Sink& sink, URNG& gen) {
+            return Fill<SkipFirst>(sink, gen, detail::LoopKindOf<U>());
+        }
+        
+        template<bool SkipFirst, typename Sink, typename URNG>
+        IndexType Fill(Sink& sink, URNG& gen, detail::ArithmeticProgressionLoop);
+        
+        template<bool SkipFirst, typename Sink, typename URNG>
+        IndexType Fill(Sink& sink, URNG& gen, detail::CountedLoop);
+        
+        typedef typename MultiplicityConstraint::template Entry<KernelType> Entry;
+        
+        IndexType target;
+        U u;
+        FloatingType x;
+        FloatingType logx;
+        IndexType u1;
+        IndexType count;
+        
+        SolverReport<FloatingType> solver;
+        detail::Acceptance<FloatingType> acceptance;
+        
+        /** @var entries holds the constants of the transformation for the k-th part size, k=0,...,count-1. */
+        std::vector<Entry> entries;
+        /** @var sizes holds u(k+1), k=0,...,count-1, when U is not an arithmetic progression. */
+        std::vector<IndexType> sizes;
+    };
+    
+    // Generate geometric random variables with different parameters.
+    // I could have created an array of std::geometric_distribution<FloatingType> or
+    // reset the parameters each time, but it is just easier to apply the transformation to
+    // a uniform and will almost certainly be faster than changing parameters around.
+    // The multiplicity constraint supplies the transformation, e.g., Bernoulli for distinct parts,
+    // and u(1) is always the first entry of the table, so skipping it means starting at k=1.
+    // The uniform is passed as raw bits so the common case Z_i = 0 is an integer comparison.
+    
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType, typename KernelType>
+    template<bool SkipFirst, typename Sink, typename URNG>
+    IndexType Sampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType,KernelType>::Fill(Sink& sink, URNG& gen, detail::ArithmeticProgressionLoop) {
+        
+        typedef PolicyTraits<U> traits;
+        
+        sink.Clear();
+        
+        std::uniform_int_distribution<std::uint64_t> bits; // Default is uniform over all 64 bit values
+        
+        IndexType total = 0;
+        MultiplicityType value;
+        const Entry* table = entries.data();
+        
+        IndexType i = traits::first + (SkipFirst ? traits::stride : 0);
+        for(IndexType k = SkipFirst ? 1 : 0; k<count; ++k, i+=traits::stride) {
+            if( (value = MultiplicityConstraint::template Sample<MultiplicityType>(bits(gen), table[k])) ) {
+                sink.Append(i, value);
+                total = detail::Add(total, detail::Multiply(i, static_cast<IndexType>(value)));
+            }
+        }
+        
+        return total;
+    }
+    
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType, typename KernelType>
+    template<bool SkipFirst, typename Sink, typename URNG>
+    IndexType Sampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType,KernelType>::Fill(Sink& sink, URNG& gen, detail::CountedLoop) {
+        
+        sink.Clear();
+        
+        std::uniform_int_distribution<std::uint64_t> bits; // Default is uniform over all 64 bit values
+        
+        IndexType total = 0;
+        MultiplicityType value;
+        const Entry* table = entries.data();
+        const IndexType* part = sizes.data();
+        
+        for(IndexType k = SkipFirst ? 1 : 0; k<count; ++k) {
+            if( (value = MultiplicityConstraint::template Sample<MultiplicityType>(bits(gen), table[k])) ) {
+                sink.Append(part[k], value);
+                total = detail::Add(total, detail::Multiply(part[k], static_cast<IndexType>(value)));
+            }
+        }
+        
+        return total;
+    }
+    
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType, typename KernelType>
+    template<typename Sink, typename URNG>
+    void Sampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType,KernelType>::DrawTo(Sink& sink, URNG& gen) {
+        
+        IndexType k = detail::DeterministicSecondHalf<MultiplicityConstraint>(acceptance, target, u1, logx, [&](URNG& g) { return Fill<true>(sink, g); }, gen, "IP::Sampler::Draw");
+        if(k) sink.Prepend(u1, static_cast<MultiplicityType>(k));
+        sink.Commit();
+    }
+    
+    
+    /**
+     Draws random integer partitions of a fixed size m without a table and without visiting every part size, for m so large that u^{-1}(m) entries do not fit in memory, with IndexType = IP::uint128 once m is beyond 64 bits.
+     Each trial walks the part sizes u(1), u(2), ... and samples Z_i directly while P(Z_i > 0) >= 1/2.
+     Beyond that P(Z_i > 0) decreases in i, so it jumps over the sizes with Z_i = 0 using a geometric number of steps of a Bernoulli envelope with the probability p of the current size,
+     and accepts the size it lands on with probability P(Z_i > 0)/p, which is exact since both probabilities are 64 bit fixed point thresholds.
+     A trial then takes O(number of distinct parts + 1/|log x|) steps instead of u^{-1}(m), and the Boltzmann sums for the tilt stop once their terms are negligible.
+     The distribution is the same as that of Sampler, but each step computes its constants on the fly, so Sampler is faster whenever its table fits.
+     
+     The trials and their steps both grow with m, so the practical limit is near m = 10^16.  Measured for IP::Triangular<IP::uint128> on one core,
+     per draw: 0.24 s at m = 10^10, 3 to 8 s at 10^12 and 10^14, 76 s at 10^16 (723 trials, 229315 distinct parts), and no draw finished
+     within an hour at 10^18.  See validate --huge-n, which checks the size and parts of one such draw.
+     
+     @code
+     typedef IP::IntegerPartition< IP::Triangular<IP::uint128>, IP::uint128 > Partition;
+     Partition ip;
+     IP::SparseSampler< IP::Triangular<IP::uint128>, IP::uint128 > sampler((IP::uint128)10000000000000000ULL);
+     sampler.Draw(ip, IP::DefaultGenerator<std::mt19937_64>());
+     @endcode
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType>
+    class SparseSampler {
+    public:
+        
+        typedef IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint> PartitionType;
+        
+        /** Solves for the tilt, see Sampler::Sampler.
+            @param m is the size of the partitions.
+            @param policy is the policy for which parts are allowed.
+            @param x_manual is the manually set value of x in cases of numerical instability; values >= 1 mean x is solved for.
+         */
+        explicit SparseSampler(IndexType m, const U& policy = U(), FloatingType x_manual = 1) : target(m), u(policy) {
+            if(x_manual < 1) {
+                solver.x = x_manual;
+                solver.t = -std::log(x_manual);
+                solver.converged = true;
+            }
+            // The log tilt is what the tables and the acceptance estimate need, and it is more precise than log(x).
+            logx = x_manual < 1 ? -solver.t : -tsolve<U,IndexType,FloatingType,MultiplicityConstraint>(m, u, solver);
+            x = std::exp(logx);
+            u1 = u(1);
+            count = Inverse(u, m);
+            acceptance.template Estimate<MultiplicityConstraint>(u, m, logx);
+        }
+        
+        /** Overwrites ip with a random partition of size m using PDC deterministic second half, see Sampler::Draw. */
+        template<typename URNG>
+        void Draw(PartitionType& ip, URNG& gen) {
+            detail::MapSink< std::map<IndexType,MultiplicityType> > sink(ip.multiplicities);
+            DrawTo(sink, gen);
+        }
+        
+        /** Appends a random partition of size m to batch, see Draw. */
+        template<typename URNG>
+        void Draw(PartitionBatch<IndexType,MultiplicityType>& batch, URNG& gen) {
+            detail::BatchSink< PartitionBatch<IndexType,MultiplicityType> > sink(batch);
+            DrawTo(sink, gen);
+        }
+        
+        /** Overwrites ip with a random partition of random size using Fristedt's method, see IntegerPartition::RandomSize. */
+        template<typename URNG>
+        void DrawRandomSize(PartitionType& ip, URNG& gen) {
+            detail::MapSink< std::map<IndexType,MultiplicityType> > sink(ip.multiplicities);
+            Fill<false>(sink, gen);
+        }
+        
+        /** Appends a random partition of random size to batch, see DrawRandomSize. */
+        template<typename URNG>
+        void DrawRandomSize(PartitionBatch<IndexType,MultiplicityType>& batch, URNG& gen) {
+            detail::BatchSink< PartitionBatch<IndexType,MultiplicityType> > sink(batch);
+            Fill<false>(sink, gen);
+            sink.Commit();
+        }
+        
+        /** @returns the size m of the partitions drawn. */
+        IndexType m() const { return target; }
+        
+        /** @returns the tilt x. */
+        FloatingType tilt() const { return x; }
+        
+        /** @returns the log tilt t = -log x. */
+        FloatingType t() const { return -logx; }
+        
+        /** @returns how the tilt was solved for, e.g., whether the solver converged; only x, t and converged are set if x was given to the constructor. */
+        const SolverReport<FloatingType>& Solver() const { return solver; }
+        
+        /** @returns u^{-1}(m), the number of part sizes, most of which are skipped. */
+        IndexType PartSizes() const { return count; }
+        
+        /** See Sampler::AcceptanceRate. */
+        FloatingType AcceptanceRate() const { return acceptance.rate; }
+        
+        /** See Sampler::MaxTrials. */
+        size_t MaxTrials() const { return acceptance.max_trials; }
+        
+        /** @param trials is the number of trials Draw makes before it gives up. */
+        void SetMaxTrials(size_t trials) { acceptance.max_trials = trials; }
+        
+        /** @returns the total number of trials made by Draw so far. */
+        size_t Trials() const { return acceptance.trials; }
+        
+    private:
+        
+        /** Draws a partition of size m into sink and commits it. */
+        template<typename Sink, typename URNG>
+        void DrawTo(Sink& sink, URNG& gen) {
+            IndexType k = detail::DeterministicSecondHalf<MultiplicityConstraint>(acceptance, target, u1, logx, [&](URNG& g) { return Fill<true>(sink, g); }, gen, "IP::SparseSampler::Draw");
+            if(k) sink.Prepend(u1, static_cast<MultiplicityType>(k));
+            sink.Commit();
+        }
+        
+        /** Samples the multiplicities of all part sizes up to m, except u(1) if SkipFirst, into sink, see detail::MapSink.
+            @returns the size of the partition generated.
+         */
+        template<bool SkipFirst, typename Sink, typename URNG>
+        IndexType Fill(Sink& sink, URNG& gen);
+        
+        typedef typename MultiplicityConstraint::template Entry<FloatingType> Entry;
+        
+        IndexType target;
+        U u;
+        FloatingType x;
+        FloatingType logx;
+        IndexType u1;
+        IndexType count;
+        
+        SolverReport<FloatingType> solver;
+        detail::Acceptance<FloatingType> acceptance;
+    };
+    
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType>
+    template<bool SkipFirst, typename Sink, typename URNG>
+    IndexType SparseSampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType>::Fill(Sink& sink, URNG& gen) {
+        
+        sink.Clear();
+        
+        std::uniform_int_distribution<std::uint64_t> bits; // Default is uniform over all 64 bit values
+        const std::uint64_t half = std::uint64_t(1) << 63;
+        
+        IndexType total = 0;
+        MultiplicityType value;
+        
+        for(IndexType k = SkipFirst ? 2 : 1; k <= count; ++k) {
+            
+            IndexType i = u(k);
+            Entry entry = MultiplicityConstraint::template Precompute<FloatingType>((FloatingType)i*logx);
+            
+            // P(Z_j > 0) < 2^-64 for this and every larger size j.
+            if(entry.threshold == 0) break;
+            
+            if(entry.threshold < half) {
+                
+                // Steps of a Bernoulli(p) envelope until its first success, where p = threshold/2^64 >= P(Z_j > 0) for all j >= k.
+                FloatingType p = std::ldexp((FloatingType)entry.threshold, -64);
+                FloatingType steps = std::floor(std::log(detail::UniformFromBits<FloatingType>(bits(gen))) / std::log1p(-p));
+                if(steps >= (FloatingType)(count - k + 1)) break;
+                
+                std::uint64_t envelope = entry.threshold;
+                k += static_cast<IndexType>(steps);
+                if(steps > 0) {
+                    i = u(k);
+                    entry = MultiplicityConstraint::template Precompute<FloatingType>((FloatingType)i*logx);
+                }
+                
+                // Given the success of the envelope, the bits are uniform below its threshold, so they fall below the threshold of size i with probability P(Z_i > 0)/p,
+                // and then they are uniform below that threshold, which is the law of the bits given Z_i > 0.
+                std::uint64_t b = std::uniform_int_distribution<std::uint64_t>(0, envelope-1)(gen);
+                value = MultiplicityConstraint::template Sample<MultiplicityType>(b, entry);
+            }
+            else
+                value = MultiplicityConstraint::template Sample<MultiplicityType>(bits(gen), entry);
+            
+            if(value) {
+                sink.Append(i, value);
+                total = detail::Add(total, detail::Multiply(i, static_cast<IndexType>(value)));
+            }
+        }
+        
+        return total;
+    }
+    
+    
+    /**
+     Creates a random integer partition of random size, using Fristedt's method, overwrites current object.
+     The one-shot calls draw with a SparseSampler, which needs no table, so they take O(number of distinct parts + 1/|log x|) time and O(number of distinct parts) memory.
+     Use a Sampler or SparseSampler to avoid solving for x on every call.
+     
+     @param m is the expected size of the partition.
+     @param x_manual is the manually set value of x in cases of numerical instability
+     @param gen is the random number generator.
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    template<typename URNG, typename FloatingType>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::RandomSize(IndexType m, FloatingType x_manual, URNG& gen) {
+        
+        SparseSampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType> sampler(m, u, x_manual);
+        sampler.DrawRandomSize(*this, gen);
+    }
+    
+    
+    /**
+     Creates a random integer partition of size m, uniformly over all partitions using Fristedt's O(n) method, overwrites current object.
+     Draws with a SparseSampler, see RandomSize.
+     
+     @param m is the size of the partition.
+     @param x_manual is the manually set value of x in cases of numerical instability
+     @param gen is the random number generator
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    template<typename URNG, typename FloatingType>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::RejectionSampling(IndexType m, FloatingType x_manual, URNG& gen) {
+        
+        SparseSampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType> sampler(m, u, x_manual);
+        
+        // Rejection sampling.  Generate random partition of random size until the size is m.
+        do {
+            sampler.DrawRandomSize(*this, gen);
+        } while(n() != m);
+        
+    }
+    
+    /**
+     Creates a random integer partition of size m, uniformly over all partitions using Fristedt's O(n) method, and PDC trivial second half with b=1, i.e., the set A = {2,3,...,n}, and trivial second half B = {1}.
+     With a multiplicity constraint, the second half is accepted only when the multiplicity it forces on u(1) is admissible, and then with the same probability as in the unconstrained case, since P(Z_1=k) is proportional to x^(u(1)k) over the admissible k.
+     Draws with a SparseSampler, see RandomSize; use a Sampler or SparseSampler to avoid solving for x on every call.
+     Throws std::domain_error when there is no partition of size m into the allowed parts, e.g., an odd m with even parts, and std::runtime_error when no trial is accepted within SparseSampler::MaxTrials(), e.g., for a poor manual x.
+     
+     @param m is the size of the partition.
+     @param x_manual is the manually set value of x in cases of numerical instability
+     @param gen is the random number generator.
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    template<typename URNG, typename FloatingType>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::PDCDeterministicSecondHalf(IndexType m, FloatingType x_manual, URNG& gen) {
+        
+        SparseSampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType> sampler(m, u, x_manual);
+        sampler.Draw(*this, gen);
+    }
+    
+    
+    /** Default random generator set to PDC Deterministic Second Half.  Use this unless you want manual control over the algorithm, as this function can be improved in the future whereas the others fix a method.
+     
+        Justification: Currently, the algorithm is the PDC Deterministic Second Half, which is provably faster than the standard rejection sampling algorithm.  Both are implemented, but PDC DSH is clearly preferred.
+     
+        It is possible the algorithm may be improved in the future, which is why the function call is generic and the code inside can be replaced with a more efficient algorithm.
+     
+     @param m is the size of the partition.
+     @param x_manual is the manually set value of x in cases of numerical instability
+     @param gen is the random number generator.
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    template<typename URNG, typename FloatingType>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::operator()(IndexType m, FloatingType x_manual, URNG& gen) {
+        PDCDeterministicSecondHalf(m,x_manual,gen);
+    }
+    
+    
+    namespace detail {
+        
+        /** Moments of the Boltzmann model for partitions with largest part at most L, where Z_i is geometric with P(Z_i >= k) = exp(-k(a i + b)).
+            Here x = exp(-a) tilts the size and y = exp(-b) tilts the number of parts.
+            F is the convex function whose minimum solves E[size] = m, E[parts] = K, and the h's are its Hessian, i.e., the covariances of (size, parts).
+         */
+        template<typename FloatingType, typename IndexType>
+        struct BoxMoments {
+            
+            BoxMoments(FloatingType a, FloatingType b, IndexType L, IndexType m, IndexType K) : F(0), size(0), parts(0), h_aa(0), h_ab(0), h_bb(0) {
+                
+                // Every exponent a i + b must be positive, and it is linear in i, so it suffices to check the ends.
+                valid = (a+b > 0) && (a*(FloatingType)L+b > 0);
+                if(!valid) return;
+                
+                for(IndexType i=1; i<=L; ++i) {
+                    FloatingType w = a*(FloatingType)i + b;
+                    
+                    // Beyond w=80 all terms are below 1e-34 relative to the first, and w only increases when a>0.
+                    if(w > 80 && a > 0) break;
+                    
+                    FloatingType one_minus_q = -std::expm1(-w);
+                    FloatingType g = std::exp(-w)/one_minus_q;          // E[Z_i]
+                    FloatingType h = g/one_minus_q;                 // Var[Z_i]
+                    FloatingType fi = (FloatingType)i;
+                    
+                    F -= std::log(one_minus_q);
+                    size += fi*g;
+                    parts += g;
+                    h_aa += fi*fi*h;
+                    h_ab += fi*h;
+                    h_bb += h;
+                }
+                F += a*(FloatingType)m + b*(FloatingType)K;
+            }
+            
+            bool valid;
+            FloatingType F, size, parts, h_aa, h_ab, h_bb;
+        };
+        
+        /** Damped Newton's method for the tilt of partitions of m with largest part at most L.
+            First solves E[size] = m with b = 0; if then E[parts] <= K the parts bound is left to the acceptance test, otherwise b > 0 is also solved for so that E[parts] = K.
+         
+            @param a is set to -log x.
+            @param b is set to -log y >= 0.
+         */
+        template<typename FloatingType, typename IndexType>
+        void SolveBoxTilt(IndexType m, IndexType K, IndexType L, FloatingType& a, FloatingType& b) {
+            
+            const FloatingType pi = 3.1415926535897932384626433832;
+            const size_t max_iters = 200;
+            
+            a = pi/std::sqrt(6.0L*(FloatingType)m);
+            b = 0;
+            
+            for(int phase = 0; phase < 2; ++phase) {
+                
+                for(size_t iters = 0; iters < max_iters; ++iters) {
+                    
+                    BoxMoments<FloatingType,IndexType> M(a, b, L, m, K);
+                    FloatingType g_a = (FloatingType)m - M.size;
+                    FloatingType g_b = phase ? (FloatingType)K - M.parts : 0;
+                    
+                    if(std::fabs(g_a) <= 1e-9*(FloatingType)m && std::fabs(g_b) <= 1e-9*(FloatingType)K) break;
+                    
+                    // Newton step solves H d = -grad F, where grad F = (g_a, g_b).
+                    FloatingType da, db;
+                    if(phase) {
+                        FloatingType det = M.h_aa*M.h_bb - M.h_ab*M.h_ab;
+                        da = -( M.h_bb*g_a - M.h_ab*g_b)/det;
+                        db = -(-M.h_ab*g_a + M.h_aa*g_b)/det;
+                    }
+                    else {
+                        da = -g_a/M.h_aa;
+                        db = 0;
+                    }
+                    
+                    // The Newton decrement -slope bounds how far F is above its minimum; below rounding in F there is nothing left to gain.
+                    FloatingType slope = g_a*da + g_b*db;
+                    if(-slope <= 1e-15*(1+std::fabs(M.F))) break;
+                    
+                    // Backtracking line search, staying inside the domain where every a i + b > 0.
+                    FloatingType step = 1;
+                    while(step > 1e-12) {
+                        BoxMoments<FloatingType,IndexType> trial(a+step*da, b+step*db, L, m, K);
+                        if(trial.valid && trial.F <= M.F + 1e-4*step*slope) break;
+                        step /= 2;
+                    }
+                    if(step <= 1e-12) break;
+                    
+                    a += step*da;
+                    b += step*db;
+                }
+                
+                if(phase == 0 && BoxMoments<FloatingType,IndexType>(a, b, L, m, K).parts <= (FloatingType)K)
+                    break;
+            }
+        }
+        
+        /** @returns log P(G <= z) for a standard normal G, by the asymptotic series for small z, where erfc underflows. */
+        template<typename FloatingType>
+        FloatingType LogNormalCdf(FloatingType z) {
+            const FloatingType pi = 3.1415926535897932384626433832;
+            if(z > -8) return std::log(std::erfc(-z/std::sqrt((FloatingType)2))/2);
+            const FloatingType r = 1/(z*z);
+            return -z*z/2 - std::log(-z*std::sqrt(2*pi)) + std::log1p(-r + 3*r*r);
+        }
+        
+        /** The acceptance rate of a trial of BoxSampling, estimated by the local limit theorem for the size S and the number of parts P of the
+            multiplicities of 2,...,L, which are about bivariate normal with the moments of BoxMoments less those of part size 1.
+            A trial is accepted with probability exp(-(a+b)d - b s) when d = m-S >= 0 and s = K-P-d >= 0, so the rate is the sum over d of the
+            density of S at m-d times a Gaussian integral over P given S, which has a closed form.
+         */
+        template<typename FloatingType, typename IndexType>
+        FloatingType BoxAcceptanceRate(FloatingType a, FloatingType b, IndexType L, IndexType m, IndexType K) {
+            
+            const FloatingType pi = 3.1415926535897932384626433832;
+            const FloatingType w = a + b;
+            
+            BoxMoments<FloatingType,IndexType> M(a, b, L, m, K);
+            const FloatingType one_minus_q = -std::expm1(-w), g = std::exp(-w)/one_minus_q, h = g/one_minus_q;
+            const FloatingType mean_size = M.size - g, mean_parts = M.parts - g;
+            const FloatingType var_size = M.h_aa - h, covariance = M.h_ab - h, var_parts = M.h_bb - h;
+            
+            // With L = 1 every trial is the partition into ones.
+            if(!(var_size > 0)) return 1;
+            
+            // P given S is normal, with at least the spread of the lattice when it is nearly determined by S, e.g., for L = 2.
+            const FloatingType deviation = std::sqrt(var_size);
+            const FloatingType slope = covariance/var_size;
+            const FloatingType spread = std::sqrt(std::max(var_parts - covariance*slope, (FloatingType)0.25));
+            
+            // The terms are negligible once exp(-w d) < e^-40 or m-d is 10 standard deviations below the mean of S.
+            const FloatingType last = std::min(40/w, std::max((FloatingType)0, (FloatingType)m - mean_size + 10*deviation));
+            const FloatingType step = std::max((FloatingType)1, last/4096);
+            
+            FloatingType rate = 0;
+            for(FloatingType d = 0; d <= last; d += step) {
+                const FloatingType z = ((FloatingType)m - d - mean_size)/deviation;
+                const FloatingType u = (FloatingType)K - d;
+                const FloatingType mu = mean_parts + slope*((FloatingType)m - d - mean_size);
+                // E[exp(-b(u-P)); P <= u] for P normal with mean mu and standard deviation spread.
+                const FloatingType log_parts = -b*(u - mu) + b*b*spread*spread/2 + LogNormalCdf((u - mu)/spread - b*spread);
+                rate += step*std::exp(-w*d - z*z/2 - std::log(std::sqrt(2*pi)*deviation) + log_parts);
+            }
+            return std::min((FloatingType)1, rate);
+        }
+    }
+    
+    
+    /**
+     Creates a random integer partition of size m with at most max_parts parts and largest part at most max_part, uniformly over all such partitions, overwrites current object.
+     A bound of 0 means no bound.  Requires U to be Unrestricted and unbounded multiplicities, since the method relies on conjugation.
+     
+     The partition is generated in the orientation where the smaller of the two bounds, L, is the largest part, and conjugated afterwards if necessary, so each trial is O(min(m,L)).
+     When m is more than half of the box, the complement of the partition inside the box is generated instead.
+     Multiplicities Z_2,...,Z_L are sampled from a Boltzmann model which tilts both the size, by x, and the number of parts, by y <= 1, and the multiplicity of 1 is the PDC deterministic second half.
+     A trial with P parts among the sizes 2,...,L and d = m - (size of those parts) is accepted with probability x^d y^(K-P) when P+d <= K, which makes every partition in the box equally likely.
+     y < 1 is only used when the bound on the number of parts K is below its mean under the size tilt alone, in which case it moves that mean to K.
+     The tilt (x,y) minimizes a convex function whose minimum also maximizes the acceptance rate, found by Newton's method in O(L) per iteration.
+     The constants of the geometric multiplicities are tabulated once per call, as in Sampler, so a trial is O(L) integer comparisons plus one logarithm per nonzero multiplicity.
+     
+     The cost is the number of trials times O(L).  Trials are few when at most one of the bounds is active, or when the box is nearly full; when both bounds cut deep into the typical shape of a partition of m,
+     the acceptance rate falls roughly like the inverse of the product of the standard deviations of the size and of the number of parts, so the method does not scale to large m with arbitrary bounds.
+     For example, at m = 10^6 with max_part 3000 and no bound on the number of parts a draw takes about 140 trials and 0.02 s, in a 4000 x 2000 box about 10^4 trials and 1 s,
+     in a 3000 x 3000 box about 5 10^4 trials and 6 s, and in a 2500 x 2500 box about 10^5 trials and 11 s.
+     The acceptance rate is estimated by the local limit theorem before the first trial, and boxes whose expected trials generate more than 10^9 part sizes, e.g., m = 10^6 inside a
+     1500 x 1500 box, which would take minutes, throw std::runtime_error instead.
+     
+     @param m is the size of the partition.
+     @param max_parts is the largest allowed number of parts, or 0 for no bound.
+     @param max_part is the largest allowed part, or 0 for no bound.
+     @param gen is the random number generator.
+     @throws std::domain_error if no partition of m fits inside the box.
+     @throws std::runtime_error if the box is outside the regime of the method, see above, or if no trial is accepted within 1000 times the expected number of trials.
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    template<typename URNG, typename FloatingType>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::BoxSampling(IndexType m, IndexType max_parts, IndexType max_part, URNG& gen) {
+        
+        static_assert(std::is_same<U, Unrestricted<IndexType> >::value, "BoxSampling requires U = Unrestricted<IndexType>");
+        static_assert(std::is_same<MultiplicityConstraint, UnboundedMultiplicity>::value, "BoxSampling requires unbounded multiplicities");
+        
+        multiplicities.clear();
+        if(m == 0) return;
+        
+        if(max_parts == 0 || max_parts > m) max_parts = m;
+        if(max_part == 0 || max_part > m) max_part = m;
+        
+        if(max_part < (m + max_parts - 1)/max_parts)
+            throw std::domain_error("BoxSampling: no partition of m fits inside a max_parts x max_part box");
+        
+        // When m is more than half the box, sample the complement of the partition inside the box instead, whose size is below half.
+        // This also covers the single partition which fills the box, whose complement is empty.
+        const bool complement = max_parts <= (2*m-1)/max_part;
+        const IndexType target = complement ? max_parts*max_part - m : m;
+        
+        // L bounds the largest part while sampling, K bounds the number of parts.
+        const bool conjugate = max_parts < max_part;
+        const IndexType L = std::min(conjugate ? max_parts : max_part, target);
+        const IndexType K = std::min(conjugate ? max_part : max_parts, target);
+        
+        FloatingType a = 0, b = 0;
+        if(target) detail::SolveBoxTilt(target, K, L, a, b);
+        
+        // Boxes where the expected trials generate more than 10^9 part sizes, tens of seconds, are outside the regime of the method, e.g., m = 10^6
+        // inside a 1500 x 1500 box, so they fail before the first trial; otherwise the budget is 1000 times the expected number of trials, as in Sampler.
+        const FloatingType rate = target ? detail::BoxAcceptanceRate(a, b, L, target, K) : 1;
+        if(target && (FloatingType)(L-1)/rate > (FloatingType)1e9) {
+            std::ostringstream message;
+            message << "BoxSampling: a partition of size " << m << " inside a " << max_parts << " x " << max_part << " box is expected to take about "
+                    << 1/rate << " trials of " << (L-1) << " part sizes each, which is beyond the 10^9 part sizes the method supports";
+            throw std::runtime_error(message.str());
+        }
+        const size_t max_trials = static_cast<size_t>(std::min((FloatingType)1e8, std::max((FloatingType)1e4, 1000/rate)));
+        
+        // The constants of the geometric kernel of the Sampler for the sizes 2,...,L, with P(Z_i > 0) = exp(-(a i + b)), computed once for all trials.
+        typedef UnboundedMultiplicity::Entry<FloatingType> Entry;
+        std::vector<Entry> entries;
+        entries.reserve(static_cast<size_t>(L));
+        for(IndexType i=2; i<=L; ++i)
+            entries.push_back(UnboundedMultiplicity::template Precompute<FloatingType>(-(a*(FloatingType)i + b)));
+        
+        std::uniform_int_distribution<std::uint64_t> bits; // Default is uniform over all 64 bit values
+        std::exponential_distribution<FloatingType> exponential;
+        
+        // The multiplicities of a trial, kept out of the map until it is accepted.
+        std::vector< std::pair<IndexType,MultiplicityType> > trial;
+        IndexType d = 0;
+        
+        bool accepted = (target == 0);
+        for(size_t trials = 0; !accepted; ++trials) {
+            if(trials == max_trials) {
+                std::ostringstream message;
+                message << "BoxSampling: no partition of size " << m << " inside a " << max_parts << " x " << max_part << " box accepted in "
+                        << max_trials << " trials, estimated acceptance rate " << rate << " per trial";
+                throw std::runtime_error(message.str());
+            }
+            trial.clear();
+            
+            IndexType partial_total = 0;
+            IndexType parts = 0;
+            bool inside = true;
+            
+            for(IndexType i=2; i<=L; ++i) {
+                const Entry& entry = entries[static_cast<size_t>(i-2)];
+                const std::uint64_t b64 = bits(gen);
+                if(b64 >= entry.threshold) continue;
+                
+                // Z_i >= 1 by inversion of U = (bits+1)/2^64 in (0,1], as in UnboundedMultiplicity::Sample, but a value which does not fit in what
+                // is left of the box ends the trial while it is still a floating point number, since it can be arbitrarily large when a i + b is near 0.
+                const FloatingType value = std::max<FloatingType>(1, std::floor(std::log(detail::UniformFromBits<FloatingType>(b64))*entry.reciprocal));
+                if(value > (FloatingType)((target - partial_total)/i) || value > (FloatingType)(K - parts)) {
+                    inside = false;
+                    break;
+                }
+                
+                const IndexType z = static_cast<IndexType>(value);
+                trial.emplace_back(i, static_cast<MultiplicityType>(z));
+                partial_total += i*z;
+                parts += z;
+            }
+            if(!inside) continue;
+            
+            d = target - partial_total;
+            if(parts + d > K) continue;
+            
+            // The DSH ratio (xy)^d times the tilt correction y^(K-P-d), accepted when a standard exponential exceeds minus its log.
+            accepted = exponential(gen) >= (a+b)*(FloatingType)d + b*(FloatingType)(K-parts-d);
+        }
+        
+        multiplicities.clear();
+        if(d) multiplicities.emplace(1, static_cast<MultiplicityType>(d));
+        for(const auto& part : trial)
+            multiplicities.emplace_hint(multiplicities.end(), part.first, part.second);
+        
+        if(conjugate)
+            Conjugate();
+        
+        if(complement)
+            ComplementMultiplicities(max_parts, max_part);
+    }
+
+    
+    /**
+     Stores many partitions contiguously, e.g., a batch of 10^6 random partitions kept for post-processing.
+     An IntegerPartition keeps its (part, multiplicity) pairs in map nodes scattered over the heap, whereas the pool appends the pairs of each partition to one array, in increasing order of the parts, and hands out a lightweight Partition with the same queries as IntegerPartition.
+     Adding a partition takes amortized O(number of distinct parts) with no allocation once the array has grown, and Clear() releases the whole batch in O(1) while keeping the memory for the next one.
+     A Partition is a pointer to the pool and a range in its array, so it is only valid until the pool is cleared or destroyed.
+     
+     @code
+     IP::UnrestrictedPartition ip;
+     IP::Sampler< IP::Unrestricted<> > sampler(10000);
+     IP::PartitionPool<> pool;
+     std::vector< IP::PartitionPool<>::Partition > batch;
+     for(int i=0;i<1000000;i++) {
+        sampler.Draw(ip, IP::DefaultGenerator<std::mt19937_64>());
+        batch.push_back(pool.Add(ip));
+     }
+     // ... use batch[i].n(), batch[i].AsMultiset(), std::cout << batch[i], ...
+     pool.Clear();
+     @endcode
+     */
+    template<typename IndexType, typename MultiplicityType>
+    class PartitionPool {
+    public:
+        
+        typedef std::pair<IndexType, MultiplicityType> value_type;
+        typedef typename std::vector<value_type>::const_iterator const_iterator;
+        
+        /** A partition stored in the pool, with the queries of IntegerPartition. */
+        class Partition {
+        public:
+            
+            Partition() : pool(nullptr), offset(0), length(0) { }
+            
+            /** @returns the (part, multiplicity) pairs in increasing order of the parts. */
+            const_iterator begin() const { return pool->pairs.begin() + offset; }
+            const_iterator end() const { return pool->pairs.begin() + offset + length; }
+            
+            /** @returns the number of distinct parts. */
+            size_t size() const { return length; }
+            
+            /** Calculates the weight of the partition.
+                @returns the weight of the partition
+             */
+            IndexType n() const {
+                IndexType temp = 0;
+                for(auto x : *this)
+                    temp = detail::Add(temp, detail::Multiply(x.first, static_cast<IndexType>(x.second)));
+                return temp;
+            }
+            
+            /** Returns a multiset of parts, see IntegerPartition::AsMultiset.
+                @returns a multiset with parts in descending order.
+             */
+            template<typename PartsType = MultiplicityType>
+            std::multiset<PartsType, std::greater<PartsType> > AsMultiset() const {
+                std::multiset<PartsType, std::greater<PartsType> > Parts;
+                auto it = Parts.begin();
+                for(auto x : *this) {
+                    for(PartsType i=0, n=x.second;i<n; i++)
+                        it = Parts.insert(it, x.first );
+                }
+                return Parts;
+            }
+            
+            /** Output operator, outputs parts one at a time from largest to smallest, as for IntegerPartition. */
+            friend std::ostream& operator<<(std::ostream& out, const Partition& ip) {
+                auto Parts = ip.AsMultiset();
+                for(auto x : Parts)
+                    out << x << ",";
+                return out;
+            }
+            
+            /** Prints out the Ferrers diagram of the partition, defined in IntegerPartitionIO.h
+                @param out is the output stream.
+             */
+            void Ferrer(std::ostream& out) const;
+            
+            /** Prints out the Ferrers diagram of the partition to std::cout, defined in IntegerPartitionIO.h */
+            void Ferrer() const;
+            
+            /** Copies the partition into an IntegerPartition, e.g., to conjugate it.
+                @param out is overwritten by the partition.
+             */
+            template<typename U, typename MultiplicityConstraint>
+            void CopyTo(IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>& out) const {
+                out.multiplicities.clear();
+                for(auto x : *this)
+                    out.multiplicities.emplace_hint(out.multiplicities.end(), x.first, x.second);
+            }
+            
+        private:
+            
+            friend class PartitionPool;
+            
+            Partition(const PartitionPool* p, size_t first, size_t count) : pool(p), offset(first), length(count) { }
+            
+            const PartitionPool* pool;
+            size_t offset;
+            size_t length;
+        };
+        
+        /** Appends a copy of ip to the pool.
+            @returns the stored partition.
+         */
+        template<typename U, typename MultiplicityConstraint>
+        Partition Add(const IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>& ip) {
+            size_t first = pairs.size();
+            for(auto x : ip.multiplicities)
+                if(x.second) pairs.push_back(x);
+            ++count;
+            return Partition(this, first, pairs.size() - first);
+        }
+        
+        /** Appends a partition given by its (part, multiplicity) pairs in increasing order of the parts.
+            @returns the stored partition.
+         */
+        template<typename InputIterator>
+        Partition Add(InputIterator first, InputIterator last) {
+            size_t offset = pairs.size();
+            for(; first != last; ++first)
+                if(first->second) pairs.push_back(value_type(first->first, first->second));
+            ++count;
+            return Partition(this, offset, pairs.size() - offset);
+        }
+        
+        /** Reserves memory so that adding partitions with up to pairs_total (part, multiplicity) pairs in all does not allocate. */
+        void Reserve(size_t pairs_total) { pairs.reserve(pairs_total); }
+        
+        /** Releases all partitions in O(1), keeping the memory for the next batch.  Every Partition of the pool becomes invalid. */
+        void Clear() {
+            pairs.clear();
+            count = 0;
+        }
+        
+        /** Releases all partitions and returns the memory.  Every Partition of the pool becomes invalid. */
+        void Release() {
+            std::vector<value_type>().swap(pairs);
+            count = 0;
+        }
+        
+        /** @returns the number of partitions added since the last Clear(). */
+        size_t Partitions() const { return count; }
+        
+        /** @returns the number of (part, multiplicity) pairs stored, which is the memory used in units of sizeof(value_type). */
+        size_t Pairs() const { return pairs.size(); }
+        
+    private:
+        
+        /** @var pairs holds the (part, multiplicity) pairs of all partitions, one partition after another. */
+        std::vector<value_type> pairs;
+        size_t count = 0;
+    };
+    
+    
+    /**
+     Stores many partitions as a structure of arrays for statistics over the whole batch: the parts of all partitions in one array, their multiplicities in another, and where each partition starts in a third.
+     The s-th partition has parts PartArray()[k] with multiplicities MultiplicityArray()[k] for OffsetArray()[s] <= k < OffsetArray()[s+1], in increasing order of the parts, and only nonzero multiplicities are stored.
+     The reductions below are plain loops over contiguous arrays of one type each, which the compiler vectorizes, and the arrays can be handed as they are to other code, e.g., to compute further statistics.
+     A Sampler or SparseSampler draws directly into the batch, without building a map first.
+     
+     @code
+     IP::Sampler< IP::Unrestricted<> > sampler(10000);
+     IP::PartitionBatch<> batch;
+     batch.Reserve(1000000, 1000000*200);
+     for(int i=0;i<1000000;i++)
+        sampler.Draw(batch, IP::DefaultGenerator<std::mt19937_64>());
+     
+     double mean_largest = 0;
+     for(size_t s=0; s<batch.Partitions(); ++s)
+        mean_largest += batch.LargestPart(s);
+     mean_largest /= batch.Partitions();
+     @endcode
+     */
+    template<typename IndexType, typename MultiplicityType>
+    class PartitionBatch {
+    public:
+        
+        PartitionBatch() : offsets(1, 0) { }
+        
+        /** Appends a copy of ip to the batch. */
+        template<typename U, typename MultiplicityConstraint>
+        void Add(const IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>& ip) {
+            for(auto x : ip.multiplicities) {
+                if(x.second) {
+                    parts.push_back(x.first);
+                    multiplicities.push_back(x.second);
+                }
+            }
+            offsets.push_back(parts.size());
+        }
+        
+        /** Reserves memory so that adding up to partitions_total partitions with up to pairs_total distinct parts in all does not allocate. */
+        void Reserve(size_t partitions_total, size_t pairs_total) {
+            offsets.reserve(partitions_total + 1);
+            parts.reserve(pairs_total);
+            multiplicities.reserve(pairs_total);
+        }
+        
+        /** Removes all partitions, keeping the memory for the next batch. */
+        void Clear() {
+            parts.clear();
+            multiplicities.clear();
+            offsets.resize(1);
+        }
+        
+        /** @returns the number of partitions in the batch. */
+        size_t Partitions() const { return offsets.size() - 1; }
+        
+        /** @returns the distinct parts of all partitions, one partition after another. */
+        const std::vector<IndexType>& PartArray() const { return parts; }
+        
+        /** @returns the multiplicities of the parts in PartArray(). */
+        const std::vector<MultiplicityType>& MultiplicityArray() const { return multiplicities; }
+        
+        /** @returns the Partitions()+1 offsets in PartArray() at which the partitions start, the last one being its size. */
+        const std::vector<size_t>& OffsetArray() const { return offsets; }
+        
+        /** @returns the weight of the s-th partition. */
+        IndexType n(size_t s) const {
+            IndexType temp = 0;
+            for(size_t k=offsets[s], end=offsets[s+1]; k<end; ++k)
+                temp = detail::Add(temp, detail::Multiply(parts[k], static_cast<IndexType>(multiplicities[k])));
+            return temp;
+        }
+        
+        /** @returns the number of parts of the s-th partition, counted with multiplicity. */
+        IndexType NumberOfParts(size_t s) const {
+            IndexType temp = 0;
+            for(size_t k=offsets[s], end=offsets[s+1]; k<end; ++k)
+                temp = detail::Add(temp, static_cast<IndexType>(multiplicities[k]));
+            return temp;
+        }
+        
+        /** @returns the number of distinct parts of the s-th partition. */
+        size_t NumberOfDistinctParts(size_t s) const { return offsets[s+1] - offsets[s]; }
+        
+        /** @returns the largest part of the s-th partition, or 0 if it is empty. */
+        IndexType LargestPart(size_t s) const { return offsets[s+1] > offsets[s] ? parts[offsets[s+1]-1] : 0; }
+        
+        /** @returns the smallest part of the s-th partition, or 0 if it is empty. */
+        IndexType SmallestPart(size_t s) const { return offsets[s+1] > offsets[s] ? parts[offsets[s]] : 0; }
+        
+        /** Finds the k-th largest part of the s-th partition, counted with multiplicity, so that k = 1 is the largest part.
+            @returns the k-th largest part, or 0 if the partition has fewer than k parts.
+         */
+        IndexType KthLargestPart(size_t s, IndexType k) const {
+            IndexType seen = 0;
+            for(size_t j=offsets[s+1]; j>offsets[s]; --j) {
+                seen = detail::Add(seen, static_cast<IndexType>(multiplicities[j-1]));
+                if(seen >= k) return parts[j-1];
+            }
+            return 0;
+        }
+        
+        /** Copies the s-th partition into an IntegerPartition.
+            @param out is overwritten by the partition.
+         */
+        template<typename U, typename MultiplicityConstraint>
+        void CopyTo(size_t s, IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>& out) const {
+            out.multiplicities.clear();
+            for(size_t k=offsets[s], end=offsets[s+1]; k<end; ++k)
+                out.multiplicities.emplace_hint(out.multiplicities.end(), parts[k], multiplicities[k]);
+        }
+        
+    private:
+        
+        template<typename> friend class detail::BatchSink;
+        
+        std::vector<IndexType> parts;
+        std::vector<MultiplicityType> multiplicities;
+        /** @var offsets holds the start of each partition in parts and multiplicities, followed by the end of the last one. */
+        std::vector<size_t> offsets;
+    };
+    
+    
+    typedef IP::IntegerPartition<IP::Unrestricted<ull>, ull, ull> UnrestrictedPartition;
+    typedef IP::IntegerPartition<IP::Even<ull>, ull, ull> EvenPartition;
+    typedef IP::IntegerPartition<IP::Odd<ull>, ull, ull> OddPartition;
+    typedef IP::IntegerPartition<IP::PartSet<ull>, ull, ull> PartSetPartition;
+    typedef IP::IntegerPartition<IP::Unrestricted<ull>, ull, ull, IP::DistinctParts> DistinctPartition;
+    
+    
+    // The instantiations of the typedefs above with the default generator std::mt19937_64 and FloatingType = long double, which the
+    // IntegerPartitionRuntime library compiles once.  With IP_EXTERN_TEMPLATES defined, which linking IntegerPartition::Runtime does,
+    // they are declared extern, so including this header no longer instantiates the samplers, ExpectedSum and xsolvebisection for them.
+    // Other policies, types and generators are instantiated in place as usual.
+    
+#define IP_INSTANTIATE_PARTITION(EXTERN, U, MC) \
+    EXTERN template class IntegerPartition<U, ull, ull, MC>; \
+    EXTERN template void IntegerPartition<U, ull, ull, MC>::RandomSize<std::mt19937_64, long double>(ull, long double, std::mt19937_64&); \
+    EXTERN template void IntegerPartition<U, ull, ull, MC>::RejectionSampling<std::mt19937_64, long double>(ull, long double, std::mt19937_64&); \
+    EXTERN template void IntegerPartition<U, ull, ull, MC>::PDCDeterministicSecondHalf<std::mt19937_64, long double>(ull, long double, std::mt19937_64&); \
+    EXTERN template void IntegerPartition<U, ull, ull, MC>::operator()<std::mt19937_64, long double>(ull, long double, std::mt19937_64&); \
+    EXTERN template class Sampler<U, ull, ull, MC>; \
+    EXTERN template void Sampler<U, ull, ull, MC>::Draw<std::mt19937_64>(IntegerPartition<U, ull, ull, MC>&, std::mt19937_64&); \
+    EXTERN template void Sampler<U, ull, ull, MC>::Draw<std::mt19937_64>(PartitionBatch<ull, ull>&, std::mt19937_64&); \
+    EXTERN template void Sampler<U, ull, ull, MC>::DrawRandomSize<std::mt19937_64>(IntegerPartition<U, ull, ull, MC>&, std::mt19937_64&); \
+    EXTERN template void Sampler<U, ull, ull, MC>::DrawRandomSize<std::mt19937_64>(PartitionBatch<ull, ull>&, std::mt19937_64&); \
+    EXTERN template long double ExpectedSum<U, ull, long double, MC>(long double, ull, U); \
+    EXTERN template long double ExpectedSumLog<U, ull, long double, MC>(long double, ull, U, long double); \
+    EXTERN template long double ExpectedSumLogDerivative<U, ull, long double, MC>(long double, ull, U, long double); \
+    EXTERN template long double tsolve<U, ull, long double, MC>(ull, const U&, SolverReport<long double>&); \
+    EXTERN template long double xsolvebisection<U, ull, long double, MC>(ull, const U&); \
+    EXTERN template long double xsolvebisection<U, ull, long double, MC>(ull, const U&, SolverReport<long double>&);
+    
+#define IP_INSTANTIATE_ALL(EXTERN) \
+    IP_INSTANTIATE_PARTITION(EXTERN, Unrestricted<ull>, UnboundedMultiplicity) \
+    IP_INSTANTIATE_PARTITION(EXTERN, Even<ull>, UnboundedMultiplicity) \
+    IP_INSTANTIATE_PARTITION(EXTERN, Odd<ull>, UnboundedMultiplicity) \
+    IP_INSTANTIATE_PARTITION(EXTERN, PartSet<ull>, UnboundedMultiplicity) \
+    IP_INSTANTIATE_PARTITION(EXTERN, Unrestricted<ull>, DistinctParts)
+    
+#ifdef IP_EXTERN_TEMPLATES
+    IP_INSTANTIATE_ALL(extern)
+#endif
+    
+}
+
+#endif
@@ -0,0 +1,100 @@
+//
+//  IntegerPartitionDiagnostics.h
+//  SimpleIntegerPartition
+//
+
+/** @file IntegerPartitionDiagnostics.h
+    @brief Readable reports on the samplers and batches of IntegerPartitionCore.h, for tuning and debugging
+ 
+    @code
+    IP::Sampler< IP::Unrestricted<> > sampler(100000);
+    IP::UnrestrictedPartition ip;
+    for(int k=0; k<1000; ++k) sampler.Draw(ip, IP::DefaultGenerator<std::mt19937_64>());
+    IP::Report(sampler, std::cerr);
+    @endcode
+ */
+
+#ifndef SimpleIntegerPartition_IntegerPartitionDiagnostics_h
+#define SimpleIntegerPartition_IntegerPartitionDiagnostics_h
+
+#include <iostream>
+#include <iomanip>
+
+#include "IntegerPartitionCore.h"
+
+namespace IP {
+    
+    namespace detail {
+        
+        /** Writes how the tilt was solved for, see SolverReport. */
+        template<typename FloatingType>
+        void ReportSolver(const SolverReport<FloatingType>& solver, std::ostream& out) {
+            out << "  solver                  " << (solver.converged ? "converged" : "DID NOT CONVERGE") << " after " << solver.evaluations
+                << " evaluations of ExpectedSumLog, residual " << (double)solver.residual << "\n";
+            if(solver.evaluations)
+                out << "  initial guess           t = " << (double)solver.guess << " from density exponent " << (double)solver.exponent << "\n";
+        }
+        
+        /** Writes the state shared by Sampler and SparseSampler, one field per line. */
+        template<typename SamplerType>
+        void ReportSampler(const char* name, const SamplerType& sampler, std::ostream& out) {
+            
+            std::ios_base::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision();
+            
+            out << name << " of size " << sampler.m() << "\n"
+                << std::setprecision(std::numeric_limits<double>::max_digits10)
+                << "  tilt x                  " << (double)sampler.tilt() << "\n"
+                << "  log tilt t              " << (double)sampler.t() << "\n"
+                << "  part sizes              " << sampler.PartSizes() << "\n"
+                << std::setprecision(6);
+            
+            ReportSolver(sampler.Solver(), out);
+            
+            out << "  acceptance rate         " << (double)sampler.AcceptanceRate()
+                << ", about " << 1/(double)sampler.AcceptanceRate() << " trials per sample\n"
+                << "  max trials              " << sampler.MaxTrials() << "\n"
+                << "  trials so far           " << sampler.Trials() << "\n";
+            
+            out.flags(flags);
+            out.precision(precision);
+        }
+        
+    }
+    
+    /** Writes the tilt and how it was solved for, the number of part sizes, the estimated acceptance rate and the trials of a sampler.
+        @param sampler is the sampler.
+        @param out is the output stream.
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType, typename KernelType>
+    void Report(const Sampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType,KernelType>& sampler, std::ostream& out=std::cout) {
+        detail::ReportSampler("Sampler", sampler, out);
+    }
+    
+    /** Writes the tilt and how it was solved for, the number of part sizes, the estimated acceptance rate and the trials of a sparse sampler.
+        @param sampler is the sampler.
+        @param out is the output stream.
+     */
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint, typename FloatingType>
+    void Report(const SparseSampler<U,IndexType,MultiplicityType,MultiplicityConstraint,FloatingType>& sampler, std::ostream& out=std::cout) {
+        detail::ReportSampler("SparseSampler", sampler, out);
+    }
+    
+    /** Writes the number of partitions and pairs in a batch and the memory they take.
+        @param batch is the batch.
+        @param out is the output stream.
+     */
+    template<typename IndexType, typename MultiplicityType>
+    void Report(const PartitionBatch<IndexType,MultiplicityType>& batch, std::ostream& out=std::cout) {
+        
+        size_t pairs = batch.PartArray().size();
+        size_t bytes = pairs*(sizeof(IndexType) + sizeof(MultiplicityType)) + batch.OffsetArray().size()*sizeof(size_t);
+        
+        out << "PartitionBatch of " << batch.Partitions() << " partitions\n"
+            << "  pairs (part, multiplicity)  " << pairs << "\n"
+            << "  bytes in use                " << bytes << "\n";
+    }
+    
+}
+
+#endif
@@ -0,0 +1,64 @@
+//
+//  IntegerPartitionIO.h
+//  SimpleIntegerPartition
+//
+
+/** @file IntegerPartitionIO.h
+    @brief Ferrers diagrams of the partitions in IntegerPartitionCore.h, printed to std::cout by default
+ 
+    Kept apart from the core since it needs <iostream>.  Include it, or IntegerPartition.h, in any translation unit which calls Ferrer.
+ */
+
+#ifndef SimpleIntegerPartition_IntegerPartitionIO_h
+#define SimpleIntegerPartition_IntegerPartitionIO_h
+
+#include <iostream>
+
+#include "IntegerPartitionCore.h"
+
+namespace IP {
+    
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::Ferrer(std::ostream& out) const {
+        
+        auto LargeParts = AsMultiset();
+        
+        auto rit = LargeParts.crbegin();
+        auto ritend = LargeParts.crend();;
+        
+        for(rit=LargeParts.crbegin(); rit != ritend; rit++)
+        {
+            ull val = *rit;
+            for(ull i=1;i<=val;i++)
+            {
+                out<<"* ";
+            }
+            out<<std::endl;
+        }
+    }
+    
+    template<typename U, typename IndexType, typename MultiplicityType, typename MultiplicityConstraint>
+    void IntegerPartition<U,IndexType,MultiplicityType,MultiplicityConstraint>::Ferrer() const {
+        Ferrer(std::cout);
+    }
+    
+    template<typename IndexType, typename MultiplicityType>
+    void PartitionPool<IndexType,MultiplicityType>::Partition::Ferrer(std::ostream& out) const {
+        // Same order as IntegerPartition::Ferrer, from the smallest part up.
+        for(auto x : *this) {
+            for(MultiplicityType k=0; k<x.second; ++k) {
+                for(IndexType i=0; i<x.first; ++i)
+                    out<<"* ";
+                out<<std::endl;
+            }
+        }
+    }
+    
+    template<typename IndexType, typename MultiplicityType>
+    void PartitionPool<IndexType,MultiplicityType>::Partition::Ferrer() const {
+        Ferrer(std::cout);
+    }
+    
+}
+
+#endif
@@ -0,0 +1,161 @@
+//
+//  IntegerPartitionParallel.h
+//  SimpleIntegerPartition
+//
+
+/** @file IntegerPartitionParallel.h
+    @brief A thread pool for the sums over the part sizes of IntegerPartitionCore.h, for policies which are not arithmetic progressions
+
+    For Unrestricted, Even, Odd and JmodM the expected size is an Euler-Maclaurin sum which costs the same at any n, but for Triangular, PartSet
+    and user policies it is a loop over the part sizes, which at n = 10^10 can take the tilt solve minutes on one core.  ParallelSums runs these
+    loops on a ThreadPool, with a result which is the same to the last bit for any number of threads, or none, see SetSumExecutor.
+
+    @code
+    IP::ParallelSums(std::thread::hardware_concurrency());
+    IP::Sampler<MyPolicy> sampler(10000000000ULL);     // solves for the tilt on all cores
+    @endcode
+ */
+
+#ifndef SimpleIntegerPartition_IntegerPartitionParallel_h
+#define SimpleIntegerPartition_IntegerPartitionParallel_h
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "IntegerPartitionCore.h"
+
+namespace IP {
+
+    /** A fixed set of threads which run the chunks of one job at a time, together with the thread which calls it, as a ChunkExecutor.
+        Jobs from several threads are run one after the other, and a job started from within a chunk of this pool, e.g., a sum of the tilt solve
+        in a chunk of a TiltGrid built on the same pool, runs in order on the thread of that chunk.
+     */
+    class ThreadPool {
+    public:
+
+        /** @param threads is the number of threads which run the chunks, including the calling thread, so threads-1 are started. */
+        explicit ThreadPool(unsigned threads) : task(nullptr), chunks(0), next(0), finished(0), generation(0), stopping(false) {
+            for(unsigned k=1; k<threads; ++k)
+                workers.push_back(std::thread([this]() { Work(); }));
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            start.notify_all();
+            for(auto& worker : workers)
+                worker.join();
+        }
+
+        /** Runs job(c) for c = 0, ..., job_chunks-1 on the threads of the pool and this one, and returns once all have run.
+            Rethrows the first exception thrown by a chunk, after the other chunks have run.
+         */
+        void operator()(size_t job_chunks, const std::function<void(size_t)>& job) {
+
+            if(job_chunks == 0) return;
+
+            if(Running() == this) {
+                for(size_t c=0; c<job_chunks; ++c)
+                    job(c);
+                return;
+            }
+
+            std::lock_guard<std::mutex> one_job(jobs);
+            std::unique_lock<std::mutex> lock(mutex);
+            task = &job;
+            chunks = job_chunks;
+            next = finished = 0;
+            error = nullptr;
+            ++generation;
+            start.notify_all();
+
+            RunChunks(lock);
+            done.wait(lock, [this]() { return finished == chunks; });
+
+            task = nullptr;
+            std::exception_ptr thrown = error;
+            error = nullptr;
+            if(thrown)
+                std::rethrow_exception(thrown);
+        }
+
+        /** @returns the number of threads which run the chunks, including the calling thread. */
+        unsigned Threads() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    private:
+
+        /** Runs chunks of the current job until none are left; called with mutex locked, which it releases while a chunk runs. */
+        void RunChunks(std::unique_lock<std::mutex>& lock) {
+            while(next < chunks) {
+                size_t c = next++;
+                lock.unlock();
+                std::exception_ptr thrown;
+                const ThreadPool* outer = Running();
+                Running() = this;
+                try {
+                    (*task)(c);
+                }
+                catch(...) {
+                    thrown = std::current_exception();
+                }
+                Running() = outer;
+                lock.lock();
+                if(thrown && !error)
+                    error = thrown;
+                if(++finished == chunks)
+                    done.notify_all();
+            }
+        }
+
+        /** @returns the pool whose chunk this thread is running, if any. */
+        static const ThreadPool*& Running() {
+            static thread_local const ThreadPool* running = nullptr;
+            return running;
+        }
+
+        void Work() {
+            std::unique_lock<std::mutex> lock(mutex);
+            size_t seen = 0;
+            for(;;) {
+                start.wait(lock, [&]() { return stopping || generation != seen; });
+                if(stopping) return;
+                seen = generation;
+                RunChunks(lock);
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex jobs, mutex;
+        std::condition_variable start, done;
+
+        // The current job, guarded by mutex.
+        const std::function<void(size_t)>* task;
+        size_t chunks, next, finished, generation;
+        std::exception_ptr error;
+        bool stopping;
+    };
+
+    /** Runs the sums over the part sizes of policies which are not arithmetic progressions, and so their tilt solves, on a ThreadPool of threads
+        threads from now on, see SetSumExecutor.  The results are the same to the last bit for any number of threads and without a pool.
+
+        @param threads is the number of threads, including the one which calls the sum; 0 runs the sums on the calling thread again.
+     */
+    inline void ParallelSums(unsigned threads) {
+        if(threads == 0) {
+            SetSumExecutor(ChunkExecutor());
+            return;
+        }
+        std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(threads);
+        SetSumExecutor([pool](size_t chunks, const std::function<void(size_t)>& task) { (*pool)(chunks, task); });
+    }
+
+}
+
+#endif
@@ -0,0 +1,309 @@
+//
+//  IntegerPartitionTiltGrid.h
+//  SimpleIntegerPartition
+//
+
+/** @file IntegerPartitionTiltGrid.h
+    @brief Precomputed log tilts of a policy over a range of sizes, for workloads which sample many different sizes
+
+    A TiltGrid solves for the log tilt t(n) once at log spaced sizes n, with its slope from ExpectedSumLogDerivative, and then answers findt
+    and findx for any size in the range by cubic Hermite interpolation of log t in log n, with a bound on the relative error of t.
+    Sizes outside the range are solved for as usual.  The grid can be built on a ThreadPool and saved to a stream.
+
+    @code
+    IP::ThreadPool pool(8);
+    IP::TiltGrid< IP::Triangular<> > grid(1000, 10000000000ULL, IP::Triangular<>(), 1e-12L, 8, std::ref(pool));
+    std::ofstream out("triangular.grid");
+    grid.Save(out);
+    // ... and in the next job, auto grid = IP::TiltGrid< IP::Triangular<> >::Load(in);
+    for(IP::ull m : sizes) {
+        IP::Sampler< IP::Triangular<> > sampler(m, IP::Triangular<>(), grid.findx(m));
+        // ...
+    }
+    @endcode
+ */
+
+#ifndef SimpleIntegerPartition_IntegerPartitionTiltGrid_h
+#define SimpleIntegerPartition_IntegerPartitionTiltGrid_h
+
+#include <istream>
+
+#include "IntegerPartitionCore.h"
+
+namespace IP {
+
+    namespace detail {
+
+        /** Runs task(c) for c = 0, ..., chunks-1 with executor, or in order on this thread if executor is empty. */
+        inline void RunChunks(const ChunkExecutor& executor, size_t chunks, const std::function<void(size_t)>& task) {
+            if(executor) {
+                executor(chunks, task);
+                return;
+            }
+            for(size_t c=0; c<chunks; ++c)
+                task(c);
+        }
+        
+        /** @returns value rounded to the nearest integer in [low, high], rounded and compared in FloatingType, so that the conversion to IndexType
+                     is in range for any IndexType, e.g., uint128, where std::llround would overflow above 2^63. */
+        template<typename IndexType, typename FloatingType>
+        IndexType RoundInto(FloatingType value, IndexType low, IndexType high) {
+            value = std::round(value);
+            if(!(value > (FloatingType)low)) return low;
+            if(!(value < (FloatingType)high)) return high;
+            return static_cast<IndexType>(value);
+        }
+    }
+
+    /**
+     The log tilts t(n) = -log x(n) of the policy U for the sizes n in [low, high], interpolated from a grid of solved sizes.
+
+     The grid starts at about points_per_decade sizes per decade, spaced evenly in s = log n.  At each size it stores y = log t, which is
+     close to linear in s, about -s/(a+1) for a density exponent a, and its slope dy/ds = n/(t E'(t)), where E'(t) is ExpectedSumLogDerivative.
+     Between two sizes y is the cubic Hermite interpolant, whose error is to leading order proportional to (s-s_a)^2 (s-s_b)^2 and so largest at
+     the middle of the interval.  Each interval is checked by solving at the size closest to its middle: if the interpolant misses it by more than
+     tolerance the size is added to the grid and both halves are checked in turn.  The error bound of an interval is then twice the miss at its
+     middle, widened by the noise of the solves and scaled to where the leading error term is largest, plus that noise; intervals between
+     consecutive integers are exact.  The noise is the precision of the solver and, for small n, the jump in t when n itself becomes a part.
+     The bounds are on the relative error of t, which is also about the relative error of 1-x, and are dominated by the noise below about
+     n = 10^5 for long double.
+
+     @code
+     IP::TiltGrid< IP::Unrestricted<> > grid(1000, 1000000000000ULL);
+     long double t = grid.findt(123456789);     // within grid.ErrorBound(123456789) of tsolve, relative
+     @endcode
+     */
+    template<typename U, typename IndexType=ull, typename FloatingType=long double, typename MultiplicityConstraint=UnboundedMultiplicity>
+    class TiltGrid {
+    public:
+
+        /** Solves for the log tilt on the grid, refined until the interpolant is within tolerance.
+            @param low is the smallest size in the grid, at least 1.
+            @param high is the largest size in the grid.
+            @param policy is the policy for which parts are allowed.
+            @param relative_tolerance is the relative error of t allowed at the middle of each interval, above the precision of the solver.
+            @param points_per_decade is the number of sizes per factor of 10 in the initial grid.
+            @param executor runs the solves of each round of refinement, e.g., std::ref to a ThreadPool; empty runs them in order on this thread.
+                   The grid is the same for any executor.
+            @throws std::invalid_argument if the range is empty, and std::runtime_error if the solver does not converge at a size in the grid.
+         */
+        TiltGrid(IndexType low, IndexType high, const U& policy = U(), FloatingType relative_tolerance = 1e-12, unsigned points_per_decade = 8,
+                 const ChunkExecutor& executor = ChunkExecutor()) : u(policy), tolerance(relative_tolerance) {
+
+            if(low < 1 || high < low) throw std::invalid_argument("TiltGrid: need 1 <= low <= high");
+            if(points_per_decade < 1) throw std::invalid_argument("TiltGrid: need at least one point per decade");
+
+            // The initial sizes, evenly spaced in log n.
+            const FloatingType span = std::log((FloatingType)high) - std::log((FloatingType)low);
+            const size_t steps = std::max<size_t>(1, static_cast<size_t>(std::ceil(span/std::log((FloatingType)10)*points_per_decade)));
+            std::vector<IndexType> sizes;
+            for(size_t j=0; j<=steps; ++j) {
+                IndexType n = j == steps ? high : detail::RoundInto((FloatingType)low*std::exp(span*(FloatingType)j/(FloatingType)steps), low, high);
+                if(sizes.empty() || n > sizes.back())
+                    sizes.push_back(n);
+            }
+
+            nodes.resize(sizes.size());
+            detail::RunChunks(executor, sizes.size(), [&](size_t k) { nodes[k] = Solve(sizes[k]); });
+
+            // Rounds of checking the middles of the intervals not yet bounded, in parallel, then splitting those which miss.
+            std::vector<char> bounded(nodes.size(), 0);
+            bounded.back() = 1;
+            for(;;) {
+                std::vector<size_t> open;
+                std::vector<Node> middles;
+                for(size_t k=0; k+1<nodes.size(); ++k) {
+                    if(bounded[k]) continue;
+                    if(nodes[k+1].n - nodes[k].n <= 1) {
+                        nodes[k].bound = 0;
+                        bounded[k] = 1;
+                        continue;
+                    }
+                    open.push_back(k);
+                }
+                if(open.empty()) break;
+
+                middles.resize(open.size());
+                detail::RunChunks(executor, open.size(), [&](size_t c) { middles[c] = Solve(Middle(nodes[open[c]], nodes[open[c]+1])); });
+
+                std::vector<Node> refined;
+                std::vector<char> refined_bounded;
+                refined.reserve(nodes.size() + open.size());
+                size_t next_open = 0;
+                for(size_t k=0; k<nodes.size(); ++k) {
+                    refined.push_back(nodes[k]);
+                    refined_bounded.push_back(bounded[k]);
+                    if(next_open == open.size() || open[next_open] != k) continue;
+
+                    const Node& a = nodes[k];
+                    const Node& b = nodes[k+1];
+                    const Node& middle = middles[next_open++];
+                    const FloatingType tau = (middle.s - a.s)/(b.s - a.s);
+                    const FloatingType miss = std::fabs(Interpolate(a, b, middle.s) - middle.y);
+                    const FloatingType precision = std::max(std::max(a.precision, b.precision), middle.precision);
+                    const FloatingType noise = precision + std::max(std::max(a.jump, b.jump), middle.jump);
+
+                    if(miss <= std::max(tolerance, 2*precision)) {
+                        // The miss is the interpolation error at tau to within the noise of the three solves, and tau^2 (1-tau)^2 is 1/16 at the
+                        // middle, so this scales it to the largest leading error term in the interval.  The solves at both ends and at m add their noise.
+                        refined.back().bound = 2*(miss + 3*noise)/(16*tau*tau*(1-tau)*(1-tau)) + 2*noise;
+                        refined_bounded.back() = 1;
+                    }
+                    else {
+                        refined.push_back(middle);
+                        refined_bounded.push_back(0);
+                    }
+                }
+                nodes.swap(refined);
+                bounded.swap(refined_bounded);
+            }
+        }
+
+        /** @returns the log tilt t = -log x for size m, interpolated if m is in the range of the grid and otherwise solved for, see findt. */
+        FloatingType findt(IndexType m) const {
+            if(!Covers(m))
+                return IP::findt<U,IndexType,FloatingType,MultiplicityConstraint>(m, u);
+            size_t k = Interval(m);
+            if(m == nodes[k].n)
+                return std::exp(nodes[k].y);
+            // Otherwise m < High(), so there is a next size.
+            return std::exp(Interpolate(nodes[k], nodes[k+1], std::log((FloatingType)m)));
+        }
+
+        /** @returns the tilt x = e^{-t} for size m, see findt. */
+        FloatingType findx(IndexType m) const {
+            return std::exp(-findt(m));
+        }
+
+        /** @returns a bound on the relative difference between findt(m) and tsolve at m, or 0 if m is outside the grid and so solved for. */
+        FloatingType ErrorBound(IndexType m) const {
+            if(!Covers(m)) return 0;
+            size_t k = Interval(m);
+            return m == nodes[k].n ? nodes[k].precision : nodes[k].bound;
+        }
+
+        /** @returns the largest ErrorBound over the range of the grid. */
+        FloatingType ErrorBound() const {
+            FloatingType bound = 0;
+            for(auto& node : nodes)
+                bound = std::max(bound, std::max(node.bound, node.precision));
+            return bound;
+        }
+
+        /** @returns whether m is in the range of the grid. */
+        bool Covers(IndexType m) const { return nodes.front().n <= m && m <= nodes.back().n; }
+
+        IndexType Low() const { return nodes.front().n; }
+        IndexType High() const { return nodes.back().n; }
+
+        /** @returns the number of sizes solved for in the grid, after refinement. */
+        size_t Sizes() const { return nodes.size(); }
+
+        /** Writes the grid as text, to be read back by Load with the same U, IndexType, FloatingType and MultiplicityConstraint; sizes of IndexType = uint128
+            are written and read with the operators of IntegerPartitionCore.h. */
+        void Save(std::ostream& out) const {
+            std::ios_base::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision(std::numeric_limits<FloatingType>::max_digits10);
+            out << "IntegerPartition TiltGrid 1\n" << std::numeric_limits<FloatingType>::digits << " " << nodes.size() << " " << tolerance << "\n";
+            for(auto& node : nodes)
+                out << node.n << " " << node.y << " " << node.dy << " " << node.precision << " " << node.jump << " " << node.bound << "\n";
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+        /** Reads a grid written by Save.  The policy is not saved, so it must be the one the grid was built for.
+            @throws std::runtime_error if the stream does not hold a grid for this FloatingType.
+         */
+        static TiltGrid Load(std::istream& in, const U& policy = U()) {
+
+            TiltGrid grid(policy);
+            std::string magic, name;
+            int version = 0, digits = 0;
+            size_t size = 0;
+            in >> magic >> name >> version >> digits >> size >> grid.tolerance;
+            if(!in || magic != "IntegerPartition" || name != "TiltGrid" || version != 1)
+                throw std::runtime_error("TiltGrid: not a saved tilt grid");
+            if(digits != std::numeric_limits<FloatingType>::digits)
+                throw std::runtime_error("TiltGrid: saved with a different FloatingType");
+
+            grid.nodes.resize(size);
+            for(auto& node : grid.nodes) {
+                in >> node.n >> node.y >> node.dy >> node.precision >> node.jump >> node.bound;
+                node.s = std::log((FloatingType)node.n);
+                if(!in || (&node != &grid.nodes.front() && node.n <= (&node - 1)->n))
+                    throw std::runtime_error("TiltGrid: bad or truncated saved grid");
+            }
+            if(grid.nodes.empty())
+                throw std::runtime_error("TiltGrid: saved grid has no sizes");
+            return grid;
+        }
+
+    private:
+
+        /** A solved size, and the error bound of the interval from it to the next one. */
+        struct Node {
+            IndexType n = 0;
+            /** @var s is log n, y is log t and dy is dy/ds. */
+            FloatingType s = 0, y = 0, dy = 0;
+            /** @var precision is the relative error of t from the tolerance of tsolve. */
+            FloatingType precision = 0;
+            /** @var jump is the relative change of t from a part of size n, which the slope dy/ds does not see. */
+            FloatingType jump = 0;
+            FloatingType bound = 0;
+        };
+
+        explicit TiltGrid(const U& policy) : u(policy), tolerance(0) { }
+
+        Node Solve(IndexType n) const {
+
+            SolverReport<FloatingType> report;
+            FloatingType t = tsolve<U,IndexType,FloatingType,MultiplicityConstraint>(n, u, report);
+            if(!report.converged) {
+                std::ostringstream message;
+                message << "TiltGrid: the tilt solve did not converge at n = " << n;
+                throw std::runtime_error(message.str());
+            }
+            // dE/dt < 0, and dt/dn = 1/(dE/dt) since E(t(n)) = n.
+            FloatingType derivative = ExpectedSumLogDerivative<U,IndexType,FloatingType,MultiplicityConstraint>(t, n, u);
+
+            Node node;
+            node.n = n;
+            node.s = std::log((FloatingType)n);
+            node.y = std::log(t);
+            node.dy = (FloatingType)n/(t*derivative);
+            if(!std::isfinite(node.dy)) node.dy = 0;
+            // tsolve stops once the residual is within max(.00001, 64 epsilon n), which moves t by that over |dE/dt|.  For small n the expected size
+            // also jumps by up to the term of a part of size n as n grows.
+            const FloatingType residual = std::max((FloatingType).00001, 64*std::numeric_limits<FloatingType>::epsilon()*(FloatingType)n);
+            const FloatingType step = (FloatingType)n*detail::MeanAt<MultiplicityConstraint>(-(FloatingType)n*t);
+            node.precision = residual/std::fabs(t*derivative) + 4*std::numeric_limits<FloatingType>::epsilon();
+            node.jump = step/std::fabs(t*derivative);
+            if(!std::isfinite(node.precision) || !std::isfinite(node.jump)) node.precision = node.jump = 1;
+            return node;
+        }
+
+        /** @returns the size closest to the middle of [a.n, b.n] in log n, strictly inside it. */
+        static IndexType Middle(const Node& a, const Node& b) {
+            return detail::RoundInto(std::exp((a.s + b.s)/2), IndexType(a.n + 1), IndexType(b.n - 1));
+        }
+
+        /** @returns the cubic Hermite interpolant of y at s between the sizes a and b. */
+        static FloatingType Interpolate(const Node& a, const Node& b, FloatingType s) {
+            const FloatingType h = b.s - a.s, tau = (s - a.s)/h, rest = 1 - tau;
+            return (1 + 2*tau)*rest*rest*a.y + tau*rest*rest*h*a.dy + tau*tau*(3 - 2*tau)*b.y - tau*tau*rest*h*b.dy;
+        }
+
+        /** @returns the last k with nodes[k].n <= m, for m in the range of the grid. */
+        size_t Interval(IndexType m) const {
+            auto after = std::upper_bound(nodes.begin(), nodes.end(), m, [](IndexType value, const Node& node) { return value < node.n; });
+            return static_cast<size_t>(after - nodes.begin()) - 1;
+        }
+
+        U u;
+        FloatingType tolerance;
+        std::vector<Node> nodes;
+    };
+
+}
+
+#endif
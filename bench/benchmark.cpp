@@ -0,0 +1,176 @@
+//
+//  benchmark.cpp
+//  SimpleIntegerPartition
+//
+
+/** @file benchmark.cpp
+    @brief Timings of the sampling kernels in IntegerPartition.h
+
+    Compares the per-trial loop of Fristedt's method as it was written originally, floor(log(U)/(i*log x)) for each part size i,
+    against the Sampler, which tabulates 1/(i log x) and x^i in 64 bit fixed point once per size, so that most sizes cost an integer
+    comparison and only the nonzero multiplicities take a log.  For distinct parts the comparison is against computing x^i/(1+x^i)
+    on every trial, which the Sampler tabulates in fixed point.  All loops insert the nonzero multiplicities into a map.
+    Finally a batch of partitions is kept in memory as IntegerPartitions, each with its own map, in a PartitionPool and in a PartitionBatch.
+
+    @code
+    g++ -O3 -std=c++11 -I. bench/benchmark.cpp -o benchmark
+    ./benchmark [largest n, default 10000000]
+    @endcode
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "IntegerPartition.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/** The original RandomSize loop for unrestricted partitions, for comparison. */
+template<typename URNG>
+IP::ull DivideLoop(IP::ull m, long double logx, std::map<IP::ull,IP::ull>& multiplicities, URNG& gen) {
+
+    multiplicities.clear();
+    std::uniform_real_distribution<long double> A;
+    IP::ull total = 0, value;
+
+    for(IP::ull i=1; i<=m; ++i) {
+        if( (value = static_cast<IP::ull>(floor(log( A(gen) )/(i*logx)))) ) {
+            multiplicities.emplace_hint(multiplicities.end(), i, value);
+            total += i*value;
+        }
+    }
+    return total;
+}
+
+/** RandomSize loop for distinct parts without a table, for comparison. */
+template<typename URNG>
+IP::ull ExpLoop(IP::ull m, long double logx, std::map<IP::ull,IP::ull>& multiplicities, URNG& gen) {
+
+    multiplicities.clear();
+    std::uniform_real_distribution<long double> A;
+    IP::ull total = 0;
+
+    for(IP::ull i=1; i<=m; ++i) {
+        long double xi = exp(i*logx);
+        if( A(gen)*(1+xi) < xi ) {
+            multiplicities.emplace_hint(multiplicities.end(), i, 1);
+            total += i;
+        }
+    }
+    return total;
+}
+
+/** Runs f until at least min_seconds have passed and at least 3 times.
+    @returns seconds per call.
+ */
+template<typename Function>
+double Time(Function f, double min_seconds = 0.5) {
+    size_t calls = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do {
+        f();
+        ++calls;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while(elapsed < min_seconds || calls < 3);
+    return elapsed/calls;
+}
+
+int main(int argc, const char * argv[]) {
+
+    IP::ull largest = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000ULL;
+
+    std::mt19937_64 gen(2014);
+    IP::UnrestrictedPartition ip;
+    std::map<IP::ull,IP::ull> multiplicities;
+    IP::ull sink = 0;
+
+    std::cout << "RandomSize trial, unrestricted, ns per part size" << std::endl;
+    std::cout << std::setw(12) << "n" << std::setw(12) << "divide" << std::setw(12) << "table" << std::setw(10) << "speedup" << std::endl;
+
+    for(IP::ull n = 10000; n <= largest; n *= 10) {
+
+        IP::Sampler< IP::Unrestricted<> > sampler(n);
+        long double logx = log(sampler.tilt());
+
+        double divide = Time([&]() { sink += DivideLoop(n, logx, multiplicities, gen); });
+        double table = Time([&]() { sampler.DrawRandomSize(ip, gen); sink += ip.n(); });
+
+        std::cout << std::setw(12) << n
+                  << std::setw(12) << std::fixed << std::setprecision(2) << 1e9*divide/n
+                  << std::setw(12) << 1e9*table/n
+                  << std::setw(10) << divide/table << std::endl;
+    }
+
+    IP::DistinctPartition distinct;
+
+    std::cout << std::endl << "RandomSize trial, distinct parts, ns per part size" << std::endl;
+    std::cout << std::setw(12) << "n" << std::setw(12) << "exp" << std::setw(12) << "table" << std::setw(10) << "speedup" << std::endl;
+
+    for(IP::ull n = 10000; n <= largest; n *= 10) {
+
+        IP::Sampler< IP::Unrestricted<>, IP::ull, IP::ull, IP::DistinctParts > sampler(n);
+        long double logx = log(sampler.tilt());
+
+        double direct = Time([&]() { sink += ExpLoop(n, logx, multiplicities, gen); });
+        double table = Time([&]() { sampler.DrawRandomSize(distinct, gen); sink += distinct.n(); });
+
+        std::cout << std::setw(12) << n
+                  << std::setw(12) << std::fixed << std::setprecision(2) << 1e9*direct/n
+                  << std::setw(12) << 1e9*table/n
+                  << std::setw(10) << direct/table << std::endl;
+    }
+
+    // A batch of random partitions of size 10^4 kept in memory, as IntegerPartitions or in a PartitionPool.
+    const size_t batch = 100000;
+    IP::Sampler< IP::Unrestricted<> > sampler(10000);
+    std::vector<IP::UnrestrictedPartition> partitions(batch);
+    IP::PartitionPool<> pool;
+    std::vector< IP::PartitionPool<>::Partition > pooled(batch);
+
+    for(size_t k=0; k<batch; ++k) {
+        sampler.DrawRandomSize(partitions[k], gen);
+        pooled[k] = pool.Add(partitions[k]);
+    }
+
+    std::cout << std::endl << "Batch of " << batch << " partitions of size about 10^4, ns per partition" << std::endl;
+    std::cout << std::setw(24) << "" << std::setw(12) << "maps" << std::setw(12) << "pool" << std::setw(10) << "speedup" << std::endl;
+
+    double copy_maps = Time([&]() { std::vector<IP::UnrestrictedPartition> copy(partitions); sink += copy.size(); });
+    double copy_pool = Time([&]() { IP::PartitionPool<> other; other.Reserve(pool.Pairs()); for(auto& p : partitions) other.Add(p); sink += other.Pairs(); });
+    std::cout << std::setw(24) << "store a copy" << std::setw(12) << std::fixed << std::setprecision(2) << 1e9*copy_maps/batch
+              << std::setw(12) << 1e9*copy_pool/batch << std::setw(10) << copy_maps/copy_pool << std::endl;
+
+    double sum_maps = Time([&]() { for(auto& p : partitions) sink += p.n(); });
+    double sum_pool = Time([&]() { for(auto& p : pooled) sink += p.n(); });
+    std::cout << std::setw(24) << "n() of every partition" << std::setw(12) << 1e9*sum_maps/batch
+              << std::setw(12) << 1e9*sum_pool/batch << std::setw(10) << sum_maps/sum_pool << std::endl;
+
+    // The same batch in a PartitionBatch, drawn into directly, and reductions over it.
+    IP::PartitionBatch<> soa;
+    std::cout << std::endl << std::setw(24) << "" << std::setw(12) << "maps" << std::setw(12) << "batch" << std::setw(10) << "speedup" << std::endl;
+
+    double draw_maps = Time([&]() { for(size_t k=0; k<1000; ++k) { sampler.DrawRandomSize(ip, gen); sink += ip.n(); } })/1000;
+    double draw_soa = Time([&]() { soa.Clear(); for(size_t k=0; k<1000; ++k) sampler.DrawRandomSize(soa, gen); sink += soa.Partitions(); })/1000;
+    std::cout << std::setw(24) << "draw" << std::setw(12) << 1e9*draw_maps
+              << std::setw(12) << 1e9*draw_soa << std::setw(10) << draw_maps/draw_soa << std::endl;
+
+    soa.Clear();
+    for(auto& p : partitions) soa.Add(p);
+
+    double sum_soa = Time([&]() { for(size_t s=0; s<batch; ++s) sink += soa.n(s); });
+    std::cout << std::setw(24) << "n() of every partition" << std::setw(12) << 1e9*sum_maps/batch
+              << std::setw(12) << 1e9*sum_soa/batch << std::setw(10) << sum_maps/sum_soa << std::endl;
+
+    double kth_maps = Time([&]() { for(auto& p : partitions) { auto parts = p.AsMultiset(); sink += parts.size() >= 10 ? *std::next(parts.begin(), 9) : 0; } });
+    double kth_soa = Time([&]() { for(size_t s=0; s<batch; ++s) sink += soa.KthLargestPart(s, 10); });
+    std::cout << std::setw(24) << "10th largest part" << std::setw(12) << 1e9*kth_maps/batch
+              << std::setw(12) << 1e9*kth_soa/batch << std::setw(10) << kth_maps/kth_soa << std::endl;
+
+    // Keeps the compiler from discarding the work.
+    std::cerr << (sink == 42 ? " " : "");
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+//
+//  precision.cpp
+//  SimpleIntegerPartition
+//
+
+/** @file precision.cpp
+    @brief Error budgets of the float, double and long double sampling kernels in IntegerPartition.h
+
+    A Sampler solves for the tilt and tabulates P(Z_i > 0) in FloatingType, and evaluates the inversion floor(log(U)/(i log x)) in
+    KernelType.  The zero test is exact in any KernelType, so the only error is in the position of the boundaries Z_i >= k for k >= 2.
+    Rounding 1/(i log x), U and log(U) moves the boundary of Z_i >= k by at most about eps(2k + 1/(2t)) in units of k, where
+    t = i|log x|, q = x^i and eps is the machine epsilon of KernelType, so the total variation distance between the sampled and
+    the exact law of Z_i is at most
+
+        eps * sum_{k>=2} q^k (2kt + 1) = eps * ( 2t(q/(1-q)^2 - q) + q^2/(1-q) ).
+
+    This is also the probability that Z_i differs from its long double value computed from the same random bits.  The multiplicities are
+    independent, so these add up to a bound for one trial of the Boltzmann model.  A draw of exact size compares the same random bits
+    trial by trial, so it differs only if one of its trials does, and its error is at most the expected number of trials times the
+    bound for one trial.  For PDCDeterministicSecondHalf the expected number of trials is (1-x)/P(N = m), about (1-x) sqrt(2 pi) sigma,
+    where sigma^2 is the variance of the size N.
+
+    The program prints the bound for unrestricted partitions for n = 10^2, ..., 10^12, then the fraction of draws in which the float
+    and double kernels disagree with the long double kernel given the same random bits, and then compares the empirical distribution
+    of each kernel with the uniform distribution over the partitions of a small n by a chi-square statistic.  Distinct parts need no
+    floating point at all in the hot loop, so their kernels are exact in any precision.
+
+    @code
+    g++ -O3 -std=c++11 -I. bench/precision.cpp -o precision
+    ./precision [largest exponent, default 12]
+    @endcode
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <cstdlib>
+#include <sstream>
+
+#include "IntegerPartition.h"
+
+/** Bound on the total variation distance of a random partition of size n from PDCDeterministicSecondHalf whose kernel has machine epsilon eps.
+    @param n is the size.
+    @param eps is the machine epsilon of the kernel.
+    @param boltzmann is set to the bound for one trial of the Boltzmann model.
+    @returns the bound for a partition of size exactly n.
+ */
+long double KernelBound(IP::ull n, long double eps, long double& boltzmann) {
+
+    const long double c = 1.28254983016186409554L; // pi/sqrt(6)
+    long double logx = -c/std::sqrt((long double)n);
+    long double sum = 0, variance = 0;
+
+    // Beyond t = 60 the terms are below 10^-26 of the leading ones.
+    IP::ull last = std::min<IP::ull>(n, (IP::ull)(60/(-logx)) + 1);
+    for(IP::ull i=1; i<=last; ++i) {
+        long double t = -(long double)i*logx;
+        long double q = std::exp(-t);
+        long double one_minus_q = -std::expm1(-t);
+        sum += 2*t*(q/(one_minus_q*one_minus_q) - q) + q*q/one_minus_q;
+        variance += (long double)i*(long double)i*q/(one_minus_q*one_minus_q);
+    }
+
+    boltzmann = eps*sum;
+    long double trials = -std::expm1(logx)*std::sqrt(2*3.14159265358979323846L*variance);
+    return trials*boltzmann;
+}
+
+/** Chi-square statistic of draws from a Sampler with the given kernel against the uniform distribution over the partitions of n. */
+template<typename KernelType>
+double ChiSquare(IP::ull n, size_t draws, size_t& cells) {
+
+    IP::Sampler<IP::Unrestricted<>, IP::ull, IP::ull, IP::UnboundedMultiplicity, long double, KernelType> sampler(n);
+    IP::UnrestrictedPartition ip;
+    std::mt19937_64 gen(2015);
+    std::map<std::string, size_t> counts;
+
+    for(size_t k=0; k<draws; ++k) {
+        sampler.Draw(ip, gen);
+        std::ostringstream out;
+        out << ip;
+        ++counts[out.str()];
+    }
+
+    cells = counts.size();
+    double expected = (double)draws/(double)cells, chi2 = 0;
+    for(auto& x : counts)
+        chi2 += ((double)x.second - expected)*((double)x.second - expected)/expected;
+    return chi2;
+}
+
+/** Draws with the given kernel and with the long double kernel from generators with the same seed.
+    Both consume the same random bits until the first multiplicity on which they disagree, so the fraction of draws which differ
+    estimates the total variation distance between the two kernels from above, up to sampling error.
+    @returns the fraction of draws which differ.
+ */
+template<typename KernelType>
+double Mismatches(IP::ull n, size_t draws) {
+
+    IP::Sampler<IP::Unrestricted<>, IP::ull, IP::ull, IP::UnboundedMultiplicity, long double, KernelType> fast(n);
+    IP::Sampler<IP::Unrestricted<>, IP::ull, IP::ull, IP::UnboundedMultiplicity, long double, long double> reference(n);
+    IP::UnrestrictedPartition a, b;
+    size_t differ = 0;
+
+    for(size_t k=0; k<draws; ++k) {
+        std::mt19937_64 gen_a(k), gen_b(k);
+        fast.Draw(a, gen_a);
+        reference.Draw(b, gen_b);
+        if(a.AsMultiset() != b.AsMultiset()) ++differ;
+    }
+    return (double)differ/(double)draws;
+}
+
+int main(int argc, const char * argv[]) {
+
+    int largest = argc > 1 ? std::atoi(argv[1]) : 12;
+
+    std::cout << "Total variation bounds for unrestricted partitions of size n" << std::endl;
+    std::cout << std::setw(8) << "n" << std::setw(14) << "float" << std::setw(14) << "double" << std::setw(14) << "long double"
+              << "   (one trial, double)" << std::endl;
+
+    IP::ull n = 100;
+    for(int e=2; e<=largest; ++e, n *= 10) {
+        long double boltzmann, ignored;
+        long double f = KernelBound(n, std::numeric_limits<float>::epsilon(), ignored);
+        long double d = KernelBound(n, std::numeric_limits<double>::epsilon(), boltzmann);
+        long double l = KernelBound(n, std::numeric_limits<long double>::epsilon(), ignored);
+        std::cout << std::setw(6) << "10^" << std::left << std::setw(2) << e << std::right << std::scientific << std::setprecision(2)
+                  << std::setw(14) << (double)f << std::setw(14) << (double)d << std::setw(14) << (double)l
+                  << std::setw(14) << (double)boltzmann << std::endl;
+    }
+
+    std::cout << std::endl << "Fraction of draws which differ from the long double kernel with the same random bits, 1000 draws" << std::endl;
+    std::cout << std::setw(8) << "n" << std::setw(14) << "float" << std::setw(14) << "double" << std::endl;
+    for(IP::ull m : {100ULL, 1000ULL, 10000ULL}) {
+        std::cout << std::setw(8) << m << std::fixed << std::setprecision(3)
+                  << std::setw(14) << Mismatches<float>(m, 1000) << std::setw(14) << Mismatches<double>(m, 1000) << std::endl;
+    }
+
+    // There are 77 partitions of 12, so 7.7*10^5 draws give about 10^4 per partition.
+    const IP::ull small = 12;
+    const size_t draws = 770000;
+    size_t cells;
+
+    std::cout << std::endl << "Chi-square against uniform over the partitions of " << small << ", " << draws << " draws" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    double chi2 = ChiSquare<float>(small, draws, cells);
+    std::cout << std::setw(14) << "float" << std::setw(10) << chi2 << " on " << cells-1 << " degrees of freedom" << std::endl;
+    chi2 = ChiSquare<double>(small, draws, cells);
+    std::cout << std::setw(14) << "double" << std::setw(10) << chi2 << " on " << cells-1 << " degrees of freedom" << std::endl;
+    chi2 = ChiSquare<long double>(small, draws, cells);
+    std::cout << std::setw(14) << "long double" << std::setw(10) << chi2 << " on " << cells-1 << " degrees of freedom" << std::endl;
+
+    return 0;
+}
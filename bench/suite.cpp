@@ -0,0 +1,270 @@
+//
+//  suite.cpp
+//  SimpleIntegerPartition
+//
+
+/** @file suite.cpp
+    @brief Benchmark suite over the samplers, policies and sizes of IntegerPartition.h, with JSON output and regression checks
+
+    Times RandomSize, RejectionSampling, PDCDeterministicSecondHalf, Sampler::Draw, findx and ExpectedSum for the policies
+    Unrestricted, Even, Odd, Triangular and JmodM<1,4>, for n = 10, 100, ..., up to --max-n.  Each case runs until it has taken
+    --min-seconds, and a series stops growing n once the next size is predicted to take more than --limit seconds per call, or, for
+    Sampler::Draw, when the table of the Sampler could have more than --max-table entries.  The member functions draw with a SparseSampler,
+    which has no table.  For each case it reports the samples per second, the ns per part size,
+    i.e., per call divided by u^{-1}(n), and, for Sampler::Draw, the trials per accepted sample.
+
+    With --json FILE the results are also written as JSON, one result per line.  With --baseline FILE they are compared with an earlier
+    JSON file, and every case which is slower by more than --tolerance, 0.25 by default, is flagged and makes the exit status 1.
+
+    @code
+    g++ -O3 -std=c++11 -I. bench/suite.cpp -o suite
+    ./suite --json baseline.json
+    # ... change something ...
+    ./suite --baseline baseline.json
+    @endcode
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "IntegerPartition.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    IP::ull max_n = 100000000ULL;
+    double min_seconds = 0.2;
+    double limit = 1;
+    IP::ull max_table = IP::ull(1) << 24;
+    double tolerance = 0.25;
+    std::string json;
+    std::string baseline;
+    std::string filter;
+};
+
+/** One case of the suite; trials is negative when the method does not count them. */
+struct Result {
+    std::string name;
+    std::string policy;
+    IP::ull n;
+    double seconds;
+    size_t calls;
+    double part_sizes;
+    double trials;
+};
+
+/** Runs f until at least min_seconds have passed, at least once.
+    @param calls is set to the number of calls.
+    @returns seconds per call.
+ */
+template<typename Function>
+double Time(Function f, double min_seconds, size_t& calls) {
+    calls = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do {
+        f();
+        ++calls;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while(elapsed < min_seconds);
+    return elapsed/calls;
+}
+
+/** Runs the series of one method over n = 10, 100, ..., recording a Result for each size.
+    @param run(n, calls, trials) times the method at size n and returns seconds per call.
+    @param growth is the exponent of n in the cost of a call, used to predict whether the next size fits in the limit.
+    @param table is true if the method builds a Sampler table of u^{-1}(n) entries.
+ */
+template<typename U, typename Run>
+void Series(const std::string& name, const std::string& policy, const U& u, double growth, bool table, const Options& options, std::vector<Result>& results, Run run) {
+
+    if(!options.filter.empty() && (name + " " + policy).find(options.filter) == std::string::npos) return;
+
+    double last = 0;
+    for(IP::ull n = 10; n <= options.max_n; n *= 10) {
+
+        IP::ull part_sizes = IP::Inverse(u, n);
+        if(last*std::pow(10.0, growth) > options.limit || (table && part_sizes > options.max_table)) break;
+
+        Result result = { name, policy, n, 0, 0, (double)part_sizes, -1 };
+        result.seconds = last = run(n, result.calls, result.trials);
+        results.push_back(result);
+
+        std::cout << std::setw(28) << std::left << name << std::setw(14) << policy << std::right << std::setw(12) << n
+                  << std::scientific << std::setprecision(3) << std::setw(14) << 1/result.seconds
+                  << std::fixed << std::setprecision(2) << std::setw(14) << 1e9*result.seconds/result.part_sizes;
+        if(result.trials >= 0) std::cout << std::setw(12) << result.trials;
+        std::cout << std::endl;
+    }
+}
+
+template<typename U>
+void RunPolicy(const std::string& policy, const Options& options, std::vector<Result>& results) {
+
+    U u;
+    IP::IntegerPartition<U> ip;
+    std::mt19937_64 gen(2014);
+    IP::ull sink = 0;
+
+    Series("RandomSize", policy, u, 0.5, false, options, results, [&](IP::ull n, size_t& calls, double&) {
+        return Time([&]() { ip.RandomSize(n, 1.0L, gen); sink += ip.n(); }, options.min_seconds, calls);
+    });
+
+    Series("RejectionSampling", policy, u, 1.25, false, options, results, [&](IP::ull n, size_t& calls, double&) {
+        return Time([&]() { ip.RejectionSampling(n, 1.0L, gen); sink += ip.n(); }, options.min_seconds, calls);
+    });
+
+    Series("PDCDeterministicSecondHalf", policy, u, 0.75, false, options, results, [&](IP::ull n, size_t& calls, double&) {
+        return Time([&]() { ip.PDCDeterministicSecondHalf(n, 1.0L, gen); sink += ip.n(); }, options.min_seconds, calls);
+    });
+
+    Series("Sampler::Draw", policy, u, 1.25, true, options, results, [&](IP::ull n, size_t& calls, double& trials) {
+        IP::Sampler<U> sampler(n, u);
+        double seconds = Time([&]() { sampler.Draw(ip, gen); sink += ip.n(); }, options.min_seconds, calls);
+        trials = (double)sampler.Trials()/(double)calls;
+        return seconds;
+    });
+
+    Series("findx", policy, u, 0.5, false, options, results, [&](IP::ull n, size_t& calls, double&) {
+        return Time([&]() { sink += (IP::ull)(1e6L*IP::findx<U>(n, u)); }, options.min_seconds, calls);
+    });
+
+    Series("ExpectedSum", policy, u, 0.5, false, options, results, [&](IP::ull n, size_t& calls, double&) {
+        long double x = IP::findx<U>(n, u);
+        return Time([&]() { sink += (IP::ull)IP::ExpectedSum<U>(x, n, u); }, options.min_seconds, calls);
+    });
+
+    // Keeps the compiler from discarding the work.
+    std::cerr << (sink == 42 ? " " : "");
+}
+
+void WriteJson(const std::string& file, const std::vector<Result>& results) {
+
+    std::ofstream out(file);
+    if(!out) throw std::runtime_error("cannot write " + file);
+
+    out << "{\n  \"suite\": \"IntegerPartition\",\n  \"results\": [\n" << std::setprecision(9);
+    for(size_t k=0; k<results.size(); ++k) {
+        const Result& r = results[k];
+        out << "    {\"name\": \"" << r.name << "\", \"policy\": \"" << r.policy << "\", \"n\": " << r.n
+            << ", \"seconds_per_call\": " << r.seconds << ", \"calls\": " << r.calls
+            << ", \"samples_per_second\": " << 1/r.seconds << ", \"ns_per_part_size\": " << 1e9*r.seconds/r.part_sizes
+            << ", \"trials_per_sample\": ";
+        if(r.trials >= 0) out << r.trials; else out << "null";
+        out << "}" << (k+1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+/** @returns the value of "key": in line, without quotes, or an empty string. */
+std::string Field(const std::string& line, const std::string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    if(at == std::string::npos) return "";
+    at = line.find_first_not_of(' ', at + key.size() + 3);
+    if(at == std::string::npos) return "";
+    if(line[at] == '"') return line.substr(at+1, line.find('"', at+1) - at - 1);
+    return line.substr(at, line.find_first_of(",}", at) - at);
+}
+
+/** Reads the results of a JSON file written by WriteJson, keyed by name, policy and n. */
+std::map<std::string, double> ReadBaseline(const std::string& file) {
+
+    std::ifstream in(file);
+    if(!in) throw std::runtime_error("cannot read " + file);
+
+    std::map<std::string, double> seconds;
+    std::string line;
+    while(std::getline(in, line)) {
+        std::string name = Field(line, "name");
+        if(name.empty()) continue;
+        seconds[name + " " + Field(line, "policy") + " " + Field(line, "n")] = std::stod(Field(line, "seconds_per_call"));
+    }
+    return seconds;
+}
+
+/** Prints the ratio of each result to the baseline and flags those slower by more than the tolerance.
+    @returns the number of regressions.
+ */
+size_t Compare(const std::vector<Result>& results, const std::map<std::string, double>& baseline, double tolerance) {
+
+    size_t regressions = 0, compared = 0;
+    std::cout << std::endl << "Compared with the baseline, time per call now / before" << std::endl;
+    for(auto& r : results) {
+        auto it = baseline.find(r.name + " " + r.policy + " " + std::to_string(r.n));
+        if(it == baseline.end()) continue;
+        ++compared;
+        double ratio = r.seconds/it->second;
+        bool regression = ratio > 1 + tolerance;
+        regressions += regression;
+        std::cout << std::setw(28) << std::left << r.name << std::setw(14) << r.policy << std::right << std::setw(12) << r.n
+                  << std::fixed << std::setprecision(3) << std::setw(10) << ratio << (regression ? "   REGRESSION" : "") << std::endl;
+    }
+    std::cout << regressions << " of " << compared << " cases slower by more than " << 100*tolerance << "%" << std::endl;
+    return regressions;
+}
+
+void Usage(std::ostream& out) {
+    out << "usage: suite [options]\n"
+           "  --max-n N          largest size, default 10^8\n"
+           "  --min-seconds S    time spent on each case, default 0.2\n"
+           "  --limit S          largest predicted time of one call, default 1\n"
+           "  --max-table N      largest Sampler table, in entries, default 2^24\n"
+           "  --filter TEXT      only the cases whose method and policy contain TEXT, e.g., \"Draw Odd\"\n"
+           "  --json FILE        write the results as JSON\n"
+           "  --baseline FILE    compare with the JSON results in FILE, exit status 1 on a regression\n"
+           "  --tolerance T      relative slowdown flagged as a regression, default 0.25\n";
+}
+
+int main(int argc, const char * argv[]) {
+
+    Options options;
+    try {
+        for(int k=1; k<argc; ++k) {
+            std::string arg = argv[k];
+            if(arg == "-h" || arg == "--help") { Usage(std::cout); return 0; }
+            if(k+1 >= argc) throw std::invalid_argument("missing value for " + arg);
+            std::string value = argv[++k];
+            if(arg == "--max-n") options.max_n = std::stoull(value);
+            else if(arg == "--min-seconds") options.min_seconds = std::stod(value);
+            else if(arg == "--limit") options.limit = std::stod(value);
+            else if(arg == "--max-table") options.max_table = std::stoull(value);
+            else if(arg == "--filter") options.filter = value;
+            else if(arg == "--json") options.json = value;
+            else if(arg == "--baseline") options.baseline = value;
+            else if(arg == "--tolerance") options.tolerance = std::stod(value);
+            else throw std::invalid_argument("unexpected argument " + arg);
+        }
+    }
+    catch(std::exception& e) {
+        std::cerr << "suite: " << e.what() << "\n";
+        Usage(std::cerr);
+        return 2;
+    }
+
+    std::vector<Result> results;
+
+    std::cout << std::setw(28) << std::left << "method" << std::setw(14) << "policy" << std::right << std::setw(12) << "n"
+              << std::setw(14) << "samples/s" << std::setw(14) << "ns/part size" << std::setw(12) << "trials" << std::endl;
+
+    try {
+        RunPolicy< IP::Unrestricted<> >("Unrestricted", options, results);
+        RunPolicy< IP::Even<> >("Even", options, results);
+        RunPolicy< IP::Odd<> >("Odd", options, results);
+        RunPolicy< IP::Triangular<> >("Triangular", options, results);
+        RunPolicy< IP::JmodM<IP::ull,1,4> >("JmodM<1,4>", options, results);
+
+        if(!options.json.empty())
+            WriteJson(options.json, results);
+        if(!options.baseline.empty())
+            return Compare(results, ReadBaseline(options.baseline), options.tolerance) ? 1 : 0;
+    }
+    catch(std::exception& e) {
+        std::cerr << "suite: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+//
+//  IntegerPartition.cpp
+//  SimpleIntegerPartition
+//
+
+/** @file IntegerPartition.cpp
+    @brief The IntegerPartitionRuntime library, built with IP_BUILD_RUNTIME=ON
+
+    Compiles the partition types typedef'd in IntegerPartition.h once, with the default generator std::mt19937_64 and
+    FloatingType = long double, see IP_INSTANTIATE_ALL.  Consumers which link IntegerPartition::Runtime get IP_EXTERN_TEMPLATES
+    and use these instead of instantiating their own.  The instruction set chosen by IP_ISA applies to this code but not to
+    code compiled by consumers.
+ */
+
+#include "IntegerPartition.h"
+
+namespace IP {
+
+    IP_INSTANTIATE_ALL()
+
+}
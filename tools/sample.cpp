@@ -0,0 +1,344 @@
+//
+//  sample.cpp
+//  SimpleIntegerPartition
+//
+
+/** @file sample.cpp
+    @brief Command line tool which writes random integer partitions of a given size to standard output
+
+    Solves for the tilt once, then draws the requested number of partitions with one Sampler per thread, each thread with its own
+    generator seeded from the seed and the thread number, so the output is reproducible for a given seed and number of threads.
+    The tilt solve of the policies which are not arithmetic progressions, i.e., triangular, jmodm and parts, sums on the same threads, see
+    IP::ParallelSums, with a tilt which does not depend on their number.
+    The threads draw into PartitionBatches in rounds, which are written in thread order.  At the end the tilt-solve time, the number
+    of samples per second and the number of trials are reported on standard error.
+
+    @code
+    g++ -O3 -std=c++11 -pthread -I. tools/sample.cpp -o ipsample
+    ./ipsample -c 1000 -t 4 10000 > partitions.txt
+    ./ipsample -p parts:1,5,10,25 -c 10 100
+    ./ipsample -p jmodm:1:4 --distinct -f binary -c 1000000 100000 > partitions.bin
+    @endcode
+
+    Text output is one partition per line, its distinct parts from largest to smallest separated by spaces, each written as part^multiplicity
+    when its multiplicity is more than 1, e.g., "5 3^2 1^4" for 5+3+3+1+1+1+1, so that the output is proportional to the number of distinct
+    parts rather than the number of parts, which for the sparse method can be beyond memory.  Binary output is, for each partition,
+    the number of distinct parts d followed by d pairs (part, multiplicity) in increasing order of the parts, all as 64 bit unsigned
+    integers in the byte order of the machine.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <thread>
+
+#include "IntegerPartition.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/** Parts congruent to J mod M with J and M given at run time, the counterpart of IP::JmodM. */
+struct ResidueClass {
+    IP::ull j, m;
+    IP::ull operator()(IP::ull i) const { return m*(i-1)+j; }
+    IP::ull inverse(IP::ull n) const { return n < j ? 0 : (n-j)/m + 1; }
+};
+
+/** The command line, see Usage. */
+struct Options {
+    IP::ull n = 0;
+    IP::ull count = 1;
+    std::string policy = "unrestricted";
+    std::string method = "pdc";
+    bool distinct = false;
+    unsigned threads = 1;
+    IP::ull seed = 2014;
+    bool binary = false;
+    bool quiet = false;
+    size_t max_trials = 0;
+};
+
+void Usage(std::ostream& out) {
+    out << "usage: ipsample [options] n\n"
+           "Numbers may be written as AeB for A*10^B, e.g., 1e14.\n"
+           "Writes random integer partitions of n to standard output.\n"
+           "  -p, --policy P       allowed part sizes: unrestricted (default), even, odd, triangular,\n"
+           "                       jmodm:J:M for parts congruent to J mod M, parts:A,B,C,... or parts:@FILE\n"
+           "                       for a list of part sizes, in a file separated by white space\n"
+           "  -d, --distinct       distinct parts only\n"
+           "  -c, --count N        number of partitions, default 1\n"
+           "  -m, --method M       pdc (default, PDC deterministic second half), rejection,\n"
+           "                       random-size (Boltzmann model, size not fixed), sparse (no table, for huge n)\n"
+           "  -t, --threads N      number of threads, default 1\n"
+           "  -s, --seed N         seed, default 2014\n"
+           "  -f, --format F       text (default) or binary\n"
+           "      --max-trials N   trials per partition before giving up, default from the estimated acceptance rate\n"
+           "  -q, --quiet          no report on standard error\n";
+}
+
+/** Writes the partitions of batch to out in the format of the options. */
+void Write(std::ostream& out, const IP::PartitionBatch<>& batch, bool binary, std::string& buffer) {
+
+    const std::vector<IP::ull>& parts = batch.PartArray();
+    const std::vector<IP::ull>& multiplicities = batch.MultiplicityArray();
+    const std::vector<size_t>& offsets = batch.OffsetArray();
+
+    buffer.clear();
+    for(size_t s=0; s<batch.Partitions(); ++s) {
+        if(binary) {
+            IP::ull d = offsets[s+1] - offsets[s];
+            buffer.append(reinterpret_cast<const char*>(&d), sizeof(d));
+            for(size_t k=offsets[s]; k<offsets[s+1]; ++k) {
+                buffer.append(reinterpret_cast<const char*>(&parts[k]), sizeof(IP::ull));
+                buffer.append(reinterpret_cast<const char*>(&multiplicities[k]), sizeof(IP::ull));
+            }
+        }
+        else {
+            for(size_t k=offsets[s+1]; k>offsets[s]; --k) {
+                if(k < offsets[s+1]) buffer += ' ';
+                buffer += std::to_string(parts[k-1]);
+                if(multiplicities[k-1] > 1) {
+                    buffer += '^';
+                    buffer += std::to_string(multiplicities[k-1]);
+                }
+            }
+            buffer += '\n';
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+}
+
+/** Draws one partition into batch with the method of the options.
+    @returns the number of trials it took, or 0 when the sampler counts them itself.
+ */
+template<typename SamplerType, typename URNG>
+size_t DrawOne(SamplerType& sampler, IP::PartitionBatch<>& batch, typename SamplerType::PartitionType& ip, const Options& options, size_t rejection_budget, URNG& gen) {
+
+    if(options.method == "random-size") {
+        sampler.DrawRandomSize(batch, gen);
+        return 1;
+    }
+    if(options.method == "rejection") {
+        for(size_t trials = 1; trials <= rejection_budget; ++trials) {
+            sampler.DrawRandomSize(ip, gen);
+            if(ip.n() == options.n) {
+                batch.Add(ip);
+                return trials;
+            }
+        }
+        std::ostringstream message;
+        message << "rejection: no partition of size " << options.n << " accepted in " << rejection_budget << " trials";
+        throw std::runtime_error(message.str());
+    }
+    sampler.Draw(batch, gen);
+    return 0;
+}
+
+/** Draws and writes all partitions with one copy of sampler per thread. */
+template<typename SamplerType>
+int Run(const SamplerType& prototype, const Options& options, double solve_seconds) {
+
+    const unsigned threads = options.threads;
+    const IP::ull round = 1024;
+
+    // Rejection accepts with probability P(N = n), the deterministic second half with P(N = n)/P(Z_{u(1)} = 0) >= P(N = n)/(1-x).
+    size_t rejection_budget = static_cast<size_t>(std::min<long double>(1e12L, (long double)prototype.MaxTrials()/-std::expm1(-prototype.t())));
+
+    std::vector<SamplerType> samplers(threads, prototype);
+    std::vector< IP::PartitionBatch<> > batches(threads);
+    std::vector<typename SamplerType::PartitionType> partitions(threads);
+    std::vector<std::mt19937_64> generators;
+    std::vector<size_t> trials(threads, 0);
+    for(unsigned t=0; t<threads; ++t) {
+        std::seed_seq seq{ (std::uint32_t)options.seed, (std::uint32_t)(options.seed >> 32), (std::uint32_t)t };
+        generators.push_back(std::mt19937_64(seq));
+        if(options.max_trials) samplers[t].SetMaxTrials(options.max_trials);
+    }
+    if(options.max_trials) rejection_budget = options.max_trials;
+
+    std::ios::sync_with_stdio(false);
+    std::string buffer;
+    Clock::time_point start = Clock::now();
+
+    for(IP::ull done = 0; done < options.count; ) {
+
+        IP::ull this_round = std::min<IP::ull>(options.count - done, round*threads);
+        std::vector<std::exception_ptr> errors(threads);
+
+        auto work = [&](unsigned t) {
+            IP::ull first = this_round*t/threads, last = this_round*(t+1)/threads;
+            batches[t].Clear();
+            try {
+                for(IP::ull k=first; k<last; ++k)
+                    trials[t] += DrawOne(samplers[t], batches[t], partitions[t], options, rejection_budget, generators[t]);
+            }
+            catch(...) {
+                errors[t] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for(unsigned t=1; t<threads; ++t)
+            pool.push_back(std::thread(work, t));
+        work(0);
+        for(auto& thread : pool)
+            thread.join();
+
+        for(unsigned t=0; t<threads; ++t) {
+            if(errors[t]) std::rethrow_exception(errors[t]);
+            Write(std::cout, batches[t], options.binary, buffer);
+        }
+        done += this_round;
+    }
+    std::cout.flush();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if(!options.quiet) {
+        size_t total_trials = 0;
+        for(unsigned t=0; t<threads; ++t)
+            total_trials += trials[t] + samplers[t].Trials();
+
+        std::cerr << std::setprecision(6)
+                  << "log tilt t = -log x = " << (double)prototype.t() << ", solved in " << solve_seconds << " s\n"
+                  << options.count << " partitions in " << seconds << " s, " << (double)options.count/seconds << " partitions per second on "
+                  << threads << " thread" << (threads == 1 ? "" : "s") << "\n";
+        if(options.method != "random-size")
+            std::cerr << total_trials << " trials, " << (double)total_trials/(double)options.count << " per partition";
+        if(options.method == "pdc" || options.method == "sparse")
+            std::cerr << ", estimated " << 1/(double)prototype.AcceptanceRate();
+        if(options.method != "random-size")
+            std::cerr << "\n";
+    }
+    return 0;
+}
+
+/** Constructs the sampler of the method for policy u, timing the tilt solve. */
+template<typename U, typename MultiplicityConstraint>
+int Dispatch(const U& u, const Options& options) {
+
+    Clock::time_point start = Clock::now();
+    if(options.method == "sparse") {
+        IP::SparseSampler<U, IP::ull, IP::ull, MultiplicityConstraint> sampler(options.n, u);
+        return Run(sampler, options, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    IP::Sampler<U, IP::ull, IP::ull, MultiplicityConstraint> sampler(options.n, u);
+    return Run(sampler, options, std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+template<typename U>
+int Dispatch(const U& u, const Options& options) {
+    if(options.distinct)
+        return Dispatch<U, IP::DistinctParts>(u, options);
+    return Dispatch<U, IP::UnboundedMultiplicity>(u, options);
+}
+
+/** Parses a nonnegative integer, either in full or as AeB for A*10^B, e.g., 1e14, rejecting trailing text and overflow. */
+IP::ull ParseCount(const std::string& text) {
+
+    size_t e = text.find_first_of("eE");
+    size_t used = 0;
+    IP::ull value = std::stoull(text.substr(0, e), &used);
+    if(used != std::min(e, text.size()) || text[0] == '-') throw std::invalid_argument("bad number " + text);
+    if(e == std::string::npos) return value;
+    if(e+1 == text.size() || !std::isdigit((unsigned char)text[e+1])) throw std::invalid_argument("bad number " + text);
+    unsigned long exponent = std::stoul(text.substr(e+1), &used);
+    if(used != text.size() - e - 1) throw std::invalid_argument("bad number " + text);
+    for(unsigned long k=0; k<exponent && value; ++k) {
+        if(value > std::numeric_limits<IP::ull>::max()/10) throw std::out_of_range("number too large " + text);
+        value *= 10;
+    }
+    return value;
+}
+
+/** Parses a list of part sizes separated by commas, or by white space in the file named after an @. */
+IP::PartSet<> ParsePartSet(const std::string& list) {
+
+    std::vector<IP::ull> sizes;
+    if(!list.empty() && list[0] == '@') {
+        std::ifstream in(list.substr(1));
+        if(!in) throw std::invalid_argument("cannot open " + list.substr(1));
+        IP::ull part;
+        while(in >> part) sizes.push_back(part);
+        if(!in.eof()) throw std::invalid_argument("bad part size in " + list.substr(1));
+    }
+    else {
+        std::istringstream in(list);
+        std::string item;
+        while(std::getline(in, item, ','))
+            sizes.push_back(std::stoull(item));
+    }
+    if(sizes.empty()) throw std::invalid_argument("empty list of part sizes");
+    return IP::PartSet<>(sizes);
+}
+
+int Dispatch(const Options& options) {
+
+    const std::string& p = options.policy;
+    if(p == "unrestricted") return Dispatch(IP::Unrestricted<>(), options);
+    if(p == "even") return Dispatch(IP::Even<>(), options);
+    if(p == "odd") return Dispatch(IP::Odd<>(), options);
+    if(p == "triangular") return Dispatch(IP::Triangular<>(), options);
+    if(p.compare(0, 6, "parts:") == 0) return Dispatch(ParsePartSet(p.substr(6)), options);
+    if(p.compare(0, 6, "jmodm:") == 0) {
+        size_t colon = p.find(':', 6);
+        if(colon == std::string::npos) throw std::invalid_argument("expected jmodm:J:M");
+        ResidueClass u = { std::stoull(p.substr(6, colon-6)), std::stoull(p.substr(colon+1)) };
+        if(u.j == 0 || u.m == 0) throw std::invalid_argument("jmodm:J:M needs J > 0 and M > 0");
+        return Dispatch(u, options);
+    }
+    throw std::invalid_argument("unknown policy " + p);
+}
+
+int main(int argc, const char * argv[]) {
+
+    Options options;
+    bool have_n = false;
+
+    try {
+        for(int k=1; k<argc; ++k) {
+            std::string arg = argv[k];
+            auto value = [&]() -> std::string {
+                if(k+1 >= argc) throw std::invalid_argument("missing value for " + arg);
+                return argv[++k];
+            };
+            if(arg == "-h" || arg == "--help") { Usage(std::cout); return 0; }
+            else if(arg == "-p" || arg == "--policy") options.policy = value();
+            else if(arg == "-d" || arg == "--distinct") options.distinct = true;
+            else if(arg == "-c" || arg == "--count") options.count = ParseCount(value());
+            else if(arg == "-m" || arg == "--method") options.method = value();
+            else if(arg == "-t" || arg == "--threads") options.threads = (unsigned)std::stoul(value());
+            else if(arg == "-s" || arg == "--seed") options.seed = std::stoull(value());
+            else if(arg == "-f" || arg == "--format") {
+                std::string format = value();
+                if(format != "text" && format != "binary") throw std::invalid_argument("unknown format " + format);
+                options.binary = format == "binary";
+            }
+            else if(arg == "--max-trials") options.max_trials = ParseCount(value());
+            else if(arg == "-q" || arg == "--quiet") options.quiet = true;
+            else if(!arg.empty() && arg[0] != '-' && !have_n) { options.n = ParseCount(arg); have_n = true; }
+            else throw std::invalid_argument("unexpected argument " + arg);
+        }
+        if(!have_n) throw std::invalid_argument("missing n");
+        if(options.threads == 0) throw std::invalid_argument("need at least one thread");
+        if(options.method != "pdc" && options.method != "rejection" && options.method != "random-size" && options.method != "sparse")
+            throw std::invalid_argument("unknown method " + options.method);
+    }
+    catch(std::exception& e) {
+        std::cerr << "ipsample: " << e.what() << "\n";
+        Usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        IP::ParallelSums(options.threads);
+        return Dispatch(options);
+    }
+    catch(std::exception& e) {
+        std::cerr << "ipsample: " << e.what() << "\n";
+        return 1;
+    }
+}
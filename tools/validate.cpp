@@ -0,0 +1,596 @@
+//
+//  validate.cpp
+//  SimpleIntegerPartition
+//
+
+/** @file validate.cpp
+    @brief Statistical validation of the samplers in IntegerPartition.h against the exact uniform distribution
+
+    A faster sampling kernel, e.g., a lower precision or skipping over part sizes, can bias the distribution without any visible error.
+    This program checks every sampler against exact distributions, on all cores.
+
+    Small n: for each built-in policy, and for distinct parts, at most two of each part and partitions inside a box, it enumerates all
+    partitions of the largest n with at most --max-cells of them, draws --samples partitions with each method, and tests the counts
+    against the uniform distribution by a chi-square test and by a Kolmogorov-Smirnov test in the order of the enumeration.
+    A partition outside of the enumeration, e.g., of the wrong size, fails the method outright.
+
+    Large n: for unrestricted partitions of --large-n it compares the distributions of the largest part and of the number of parts,
+    which are the same by conjugation, and for partitions into distinct parts the distribution of the number of parts, with their exact
+    distributions computed by recurrences, by a Kolmogorov-Smirnov test.  It also prints the means and standard deviations next to their
+    asymptotics, the Erdos-Lehner law (sqrt(n)/c)(log(sqrt(n)/c) + G) with G Gumbel and c = pi/sqrt(6) for the largest part, and
+    the normal law with mean sqrt(12n) log(2)/pi and variance (sqrt(12n)/pi)(1/2 - 6 log(2)^2/pi^2) for the number of distinct parts.
+
+    Huge n: with --huge-n N it draws one partition of N, e.g., 10^14, with a SparseSampler of 128 bit triangular parts, and checks that its
+    size is exactly N and its parts are triangular, reporting the solve and draw times, the trials and the number of distinct parts.  This
+    is a check of the 128 bit arithmetic and of the skips over part sizes, not of the distribution, and is off by default since a draw
+    takes seconds at 10^14 and over a minute at 10^16.
+
+    A test fails when its p-value is below --alpha.  The exit status is the number of failed tests, capped at 100.
+
+    @code
+    g++ -O3 -std=c++11 -pthread -I. tools/validate.cpp -o validate
+    ./validate                  # 10^6 samples per method at small n, 1000 at n = 10^5
+    ./validate --quick          # 10^5 and 200 at n = 10^4
+    ./validate --quick --huge-n 100000000000000
+    @endcode
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
+#include <chrono>
+
+#include "IntegerPartition.h"
+
+using IP::ull;
+
+struct Options {
+    size_t samples = 1000000;
+    size_t max_cells = 300;
+    ull large_n = 100000;
+    size_t large_samples = 1000;
+    ull huge_n = 0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    ull seed = 2015;
+    double alpha = 1e-4;
+};
+
+/** The number of tests run and failed so far, and the number of the current test, which seeds its generators. */
+struct Tally {
+    unsigned tests = 0;
+    unsigned failed = 0;
+};
+
+
+/** @returns the regularized upper incomplete gamma function Q(a,x), the p-value of a chi-square statistic 2x on 2a degrees of freedom. */
+double GammaQ(double a, double x) {
+
+    if(x <= 0) return 1;
+    double log_prefactor = a*std::log(x) - x - std::lgamma(a);
+
+    if(x < a+1) {
+        // Series for P(a,x).
+        double term = 1/a, sum = term;
+        for(int k=1; k<1000 && std::fabs(term) > 1e-16*std::fabs(sum); ++k) {
+            term *= x/(a+k);
+            sum += term;
+        }
+        return 1 - sum*std::exp(log_prefactor);
+    }
+
+    // Continued fraction for Q(a,x) by the modified Lentz method.
+    const double tiny = 1e-300;
+    double b = x+1-a, c = 1/tiny, d = 1/b, h = d;
+    for(int k=1; k<1000; ++k) {
+        double an = -k*(k-a);
+        b += 2;
+        d = an*d + b;
+        if(std::fabs(d) < tiny) d = tiny;
+        c = b + an/c;
+        if(std::fabs(c) < tiny) c = tiny;
+        d = 1/d;
+        double delta = d*c;
+        h *= delta;
+        if(std::fabs(delta-1) < 1e-16) break;
+    }
+    return std::exp(log_prefactor)*h;
+}
+
+/** @returns the p-value of the Kolmogorov-Smirnov statistic D of a sample of size N, which is conservative for a discrete distribution. */
+double KolmogorovQ(double D, double N) {
+
+    double lambda = (std::sqrt(N) + 0.12 + 0.11/std::sqrt(N))*D;
+    if(lambda < 0.2) return 1;
+    double sum = 0, sign = 1;
+    for(int k=1; k<=100; ++k, sign = -sign) {
+        double term = sign*std::exp(-2.0*k*k*lambda*lambda);
+        sum += term;
+        if(std::fabs(term) < 1e-16) break;
+    }
+    return std::max(0.0, std::min(1.0, 2*sum));
+}
+
+/** @returns the largest distance between the empirical distribution function of counts and the distribution function cdf, which both have jumps at the same points. */
+double KolmogorovD(const std::vector<size_t>& counts, const std::vector<double>& cdf, size_t total) {
+
+    double D = 0, empirical = 0;
+    for(size_t k=0; k<counts.size(); ++k) {
+        empirical += (double)counts[k]/(double)total;
+        D = std::max(D, std::fabs(empirical - cdf[k]));
+    }
+    return D;
+}
+
+
+/** Encodes a partition, given by (part, multiplicity) pairs in increasing order of the parts, as a string for hashing. */
+class Encoder {
+public:
+    void Clear() { key.clear(); }
+    void Append(ull part, ull multiplicity) {
+        key.append(reinterpret_cast<const char*>(&part), sizeof(part));
+        key.append(reinterpret_cast<const char*>(&multiplicity), sizeof(multiplicity));
+    }
+    std::string key;
+};
+
+/** Enumerates the partitions of remaining into parts[j], parts[j+1], ... with at most parts_left parts, appending their encodings to keys. */
+template<typename MultiplicityConstraint>
+void Enumerate(const std::vector<ull>& parts, size_t j, ull remaining, ull parts_left, std::vector< std::pair<ull,ull> >& stack, std::vector<std::string>& keys) {
+
+    if(remaining == 0) {
+        Encoder encoder;
+        for(auto& x : stack) encoder.Append(x.first, x.second);
+        keys.push_back(encoder.key);
+        return;
+    }
+    if(j == parts.size() || parts[j] > remaining || parts_left == 0) return;
+
+    Enumerate<MultiplicityConstraint>(parts, j+1, remaining, parts_left, stack, keys);
+    for(ull k=1; k*parts[j] <= remaining && k <= parts_left && MultiplicityConstraint::Admissible(k); ++k) {
+        stack.push_back(std::make_pair(parts[j], k));
+        Enumerate<MultiplicityConstraint>(parts, j+1, remaining - k*parts[j], parts_left - k, stack, keys);
+        stack.pop_back();
+    }
+}
+
+/** @returns the encodings of all partitions of n into the parts of u with at most max_parts parts and parts at most max_part, 0 meaning no bound. */
+template<typename MultiplicityConstraint, typename U>
+std::vector<std::string> Enumerate(const U& u, ull n, ull max_parts = 0, ull max_part = 0) {
+
+    std::vector<ull> parts;
+    IP::ForEachPart(u, n, [&](ull i) { if(max_part == 0 || i <= max_part) parts.push_back(i); });
+
+    std::vector< std::pair<ull,ull> > stack;
+    std::vector<std::string> keys;
+    Enumerate<MultiplicityConstraint>(parts, 0, n, max_parts ? max_parts : n, stack, keys);
+    return keys;
+}
+
+/** @returns the largest n <= 1000 with at most max_cells partitions of n into the parts of u, and at least two. */
+template<typename MultiplicityConstraint, typename U>
+ull SmallSize(const U& u, size_t max_cells) {
+    ull best = 0;
+    for(ull n=2; n<=1000; ++n) {
+        size_t cells = Enumerate<MultiplicityConstraint>(u, n).size();
+        if(cells > max_cells) break;
+        if(cells >= 2) best = n;
+    }
+    return best;
+}
+
+
+/** Draws samples partitions with copies of draw, one per thread, and hands each to record(thread, batch), where the partition is the only one in the batch.
+    The generator of thread t is seeded by (seed, test, t), so the results are reproducible for a given number of threads.
+ */
+template<typename Draw, typename Record>
+void Parallel(size_t samples, const Options& options, unsigned test, const Draw& draw, Record record) {
+
+    unsigned threads = options.threads;
+    std::vector<std::exception_ptr> errors(threads);
+
+    auto work = [&](unsigned t) {
+        try {
+            std::seed_seq seq{ (std::uint32_t)options.seed, (std::uint32_t)test, (std::uint32_t)t };
+            std::mt19937_64 gen(seq);
+            Draw mine = draw;
+            IP::PartitionBatch<> batch;
+            for(size_t k = samples*t/threads; k < samples*(t+1)/threads; ++k) {
+                batch.Clear();
+                mine(batch, gen);
+                record(t, batch);
+            }
+        }
+        catch(...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned t=1; t<threads; ++t)
+        pool.push_back(std::thread(work, t));
+    work(0);
+    for(auto& thread : pool)
+        thread.join();
+
+    for(auto& error : errors)
+        if(error) std::rethrow_exception(error);
+}
+
+/** Tests draws of partitions of n against the uniform distribution over keys. */
+template<typename Draw>
+void CheckUniform(const std::string& method, const std::string& name, ull n, const std::vector<std::string>& keys, const Draw& draw, const Options& options, Tally& tally) {
+
+    std::unordered_map<std::string, size_t> index;
+    for(size_t k=0; k<keys.size(); ++k)
+        index[keys[k]] = k;
+
+    std::vector< std::vector<size_t> > counts(options.threads, std::vector<size_t>(keys.size(), 0));
+    std::vector<size_t> invalid(options.threads, 0);
+
+    Parallel(options.samples, options, tally.tests, draw, [&](unsigned t, const IP::PartitionBatch<>& batch) {
+        Encoder encoder;
+        for(size_t k=0; k<batch.PartArray().size(); ++k)
+            encoder.Append(batch.PartArray()[k], batch.MultiplicityArray()[k]);
+        auto it = index.find(encoder.key);
+        if(it == index.end()) ++invalid[t];
+        else ++counts[t][it->second];
+    });
+
+    std::vector<size_t> total(keys.size(), 0);
+    size_t bad = 0;
+    for(unsigned t=0; t<options.threads; ++t) {
+        bad += invalid[t];
+        for(size_t k=0; k<keys.size(); ++k)
+            total[k] += counts[t][k];
+    }
+
+    double expected = (double)options.samples/(double)keys.size(), chi2 = 0;
+    std::vector<double> cdf(keys.size());
+    for(size_t k=0; k<keys.size(); ++k) {
+        chi2 += ((double)total[k] - expected)*((double)total[k] - expected)/expected;
+        cdf[k] = (double)(k+1)/(double)keys.size();
+    }
+    double df = (double)keys.size() - 1;
+    double chi2_p = GammaQ(df/2, chi2/2);
+    double D = KolmogorovD(total, cdf, options.samples);
+    double ks_p = KolmogorovQ(D, (double)options.samples);
+
+    bool pass = bad == 0 && chi2_p >= options.alpha && ks_p >= options.alpha;
+    ++tally.tests;
+    tally.failed += !pass;
+
+    std::cout << (pass ? "PASS  " : "FAIL  ") << std::left << std::setw(12) << method << std::setw(30) << name << std::right
+              << " n=" << std::setw(4) << n << " cells=" << std::setw(4) << keys.size()
+              << std::fixed << std::setprecision(1) << "  chi2=" << std::setw(7) << chi2
+              << std::setprecision(4) << " p=" << std::setw(6) << chi2_p
+              << std::scientific << std::setprecision(2) << "  KS D=" << D << std::fixed << std::setprecision(4) << " p=" << std::setw(6) << ks_p;
+    if(bad) std::cout << "  " << bad << " partitions not of size n or not allowed";
+    std::cout << std::endl;
+}
+
+/** Runs every method on partitions of the largest n with at most max_cells partitions into the parts of u. */
+template<typename MultiplicityConstraint, typename U>
+void CheckPolicy(const std::string& name, const U& u, const Options& options, Tally& tally) {
+
+    ull n = SmallSize<MultiplicityConstraint>(u, options.max_cells);
+    if(n == 0) {
+        std::cout << "SKIP  " << name << ": no n with between 2 and " << options.max_cells << " partitions" << std::endl;
+        return;
+    }
+    std::vector<std::string> keys = Enumerate<MultiplicityConstraint>(u, n);
+
+    IP::Sampler<U, ull, ull, MultiplicityConstraint> sampler(n, u);
+    IP::Sampler<U, ull, ull, MultiplicityConstraint, long double, double> sampler_double(n, u);
+    IP::Sampler<U, ull, ull, MultiplicityConstraint, long double, float> sampler_float(n, u);
+    IP::SparseSampler<U, ull, ull, MultiplicityConstraint> sparse(n, u);
+
+    CheckUniform("pdc", name, n, keys, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { sampler.Draw(batch, gen); }, options, tally);
+    CheckUniform("pdc-double", name, n, keys, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { sampler_double.Draw(batch, gen); }, options, tally);
+    CheckUniform("pdc-float", name, n, keys, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { sampler_float.Draw(batch, gen); }, options, tally);
+    CheckUniform("sparse", name, n, keys, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { sparse.Draw(batch, gen); }, options, tally);
+    CheckUniform("rejection", name, n, keys, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable {
+        do {
+            batch.Clear();
+            sampler.DrawRandomSize(batch, gen);
+        } while(batch.n(0) != n);
+    }, options, tally);
+}
+
+/** Runs BoxSampling on partitions of n with at most max_parts parts of size at most max_part. */
+void CheckBox(ull n, ull max_parts, ull max_part, const Options& options, Tally& tally) {
+
+    std::vector<std::string> keys = Enumerate<IP::UnboundedMultiplicity>(IP::Unrestricted<>(), n, max_parts, max_part);
+    std::ostringstream name;
+    name << "Unrestricted, box " << max_parts << "x" << max_part;
+
+    CheckUniform("box", name.str(), n, keys, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) {
+        IP::UnrestrictedPartition ip;
+        ip.BoxSampling(n, max_parts, max_part, gen);
+        batch.Add(ip);
+    }, options, tally);
+}
+
+
+/** Compares a sample of a statistic with its exact distribution by a Kolmogorov-Smirnov test, and prints its mean and standard deviation next to the exact and the asymptotic ones.
+    @param values is the sample.
+    @param pmf is the exact probability of each value 0, 1, ....
+ */
+void CheckLarge(const std::string& method, const std::string& name, const std::vector<ull>& values, const std::vector<long double>& pmf,
+                double asymptotic_mean, double asymptotic_deviation, const Options& options, Tally& tally) {
+
+    std::vector<size_t> counts(pmf.size(), 0);
+    size_t outside = 0;
+    for(ull v : values) {
+        if(v < pmf.size()) ++counts[v];
+        else ++outside;
+    }
+
+    std::vector<double> cdf(pmf.size());
+    long double cumulative = 0, exact_mean = 0, exact_square = 0;
+    for(size_t k=0; k<pmf.size(); ++k) {
+        cumulative += pmf[k];
+        cdf[k] = (double)cumulative;
+        exact_mean += k*pmf[k];
+        exact_square += (long double)k*k*pmf[k];
+    }
+
+    double mean = 0, square = 0;
+    for(ull v : values) {
+        mean += (double)v;
+        square += (double)v*(double)v;
+    }
+    mean /= values.size();
+    double deviation = std::sqrt(std::max(0.0, square/values.size() - mean*mean));
+
+    double D = std::max(KolmogorovD(counts, cdf, values.size()), outside ? 1 - cdf.back() : 0.0);
+    double p = KolmogorovQ(D, (double)values.size());
+    bool pass = p >= options.alpha;
+    ++tally.tests;
+    tally.failed += !pass;
+
+    std::cout << (pass ? "PASS  " : "FAIL  ") << std::left << std::setw(12) << method << std::setw(30) << name << std::right
+              << std::fixed << std::setprecision(2)
+              << " mean " << mean << " (exact " << (double)exact_mean << ", asymptotic " << asymptotic_mean << ")"
+              << " sd " << deviation << " (exact " << (double)std::sqrt(exact_square - exact_mean*exact_mean) << ", asymptotic " << asymptotic_deviation << ")"
+              << std::setprecision(4) << "  KS D=" << D << " p=" << p << std::endl;
+}
+
+/** @returns the exact distribution of the largest part of a uniform partition of n, or an empty vector if p(n) overflows long double. */
+std::vector<long double> LargestPartDistribution(ull n) {
+
+    const double pi = 3.14159265358979323846;
+    if(pi*std::sqrt(2.0*n/3)/std::log(10.0) + 10 > std::numeric_limits<long double>::max_exponent10)
+        return std::vector<long double>();
+
+    // P(largest part > (sqrt(n)/c)(log(sqrt(n)/c) + v)) is about exp(-v), so stopping at v = 45 loses less than 10^-19 of p(n).
+    // Euler's pentagonal number recurrence would give p(n) directly, but it cancels catastrophically in floating point.
+    double scale = std::sqrt((double)n)/(pi/std::sqrt(6.0));
+    ull largest = std::min<ull>(n, (ull)(scale*(std::log(scale) + 45)) + 1);
+
+    // a[m] = number of partitions of m into parts at most k, for k = 1, 2, ..., so a[n] is the number of partitions of n with largest part at most k.
+    std::vector<long double> a(n+1, 0), pmf(largest+1, 0);
+    a[0] = 1;
+    long double previous = 0;
+    for(ull k=1; k<=largest; ++k) {
+        for(ull m=k; m<=n; ++m)
+            a[m] += a[m-k];
+        pmf[k] = a[n] - previous;
+        previous = a[n];
+    }
+    for(auto& x : pmf) x /= previous;
+    return pmf;
+}
+
+/** @returns the exact distribution of the number of parts of a uniform partition of n into distinct parts. */
+std::vector<long double> DistinctPartsDistribution(ull n) {
+
+    // The partitions of n into k distinct parts are those of n - k(k+1)/2 into at most k parts, i.e., into parts at most k.
+    std::vector<long double> a(n+1, 0), pmf(1, 0);
+    a[0] = 1;
+    long double total = 0;
+    for(ull k=1; k*(k+1)/2 <= n; ++k) {
+        for(ull m=k; m<=n; ++m)
+            a[m] += a[m-k];
+        pmf.push_back(a[n - k*(k+1)/2]);
+        total += pmf.back();
+    }
+    for(auto& x : pmf) x /= total;
+    return pmf;
+}
+
+/** Compares the samplers with the exact distributions of the largest part and the number of parts at n = large_n. */
+void CheckLargeN(const Options& options, Tally& tally) {
+
+    const double pi = 3.14159265358979323846, gamma = 0.57721566490153286;
+    const ull n = options.large_n;
+
+    std::ostringstream name;
+    name << "Unrestricted, n=" << n;
+
+    IP::Sampler< IP::Unrestricted<> > sampler(n);
+    IP::SparseSampler< IP::Unrestricted<> > sparse(n);
+
+    // Erdos-Lehner: the largest part is (sqrt(n)/c)(log(sqrt(n)/c) + G) with G standard Gumbel.
+    double scale = std::sqrt((double)n)/(pi/std::sqrt(6.0));
+    double gumbel_mean = scale*(std::log(scale) + gamma), gumbel_deviation = scale*pi/std::sqrt(6.0);
+
+    std::vector<long double> pmf;
+    for(int method=0; method<2; ++method) {
+
+        std::vector< std::vector<ull> > largest(options.threads), parts(options.threads);
+        auto record = [&](unsigned t, const IP::PartitionBatch<>& batch) {
+            largest[t].push_back(batch.LargestPart(0));
+            parts[t].push_back(batch.NumberOfParts(0));
+        };
+        if(method == 0)
+            Parallel(options.large_samples, options, tally.tests, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { sampler.Draw(batch, gen); }, record);
+        else
+            Parallel(options.large_samples, options, tally.tests, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { sparse.Draw(batch, gen); }, record);
+
+        std::vector<ull> all_largest, all_parts;
+        for(unsigned t=0; t<options.threads; ++t) {
+            all_largest.insert(all_largest.end(), largest[t].begin(), largest[t].end());
+            all_parts.insert(all_parts.end(), parts[t].begin(), parts[t].end());
+        }
+
+        if(pmf.empty()) {
+            pmf = LargestPartDistribution(n);
+            if(pmf.empty()) {
+                std::cout << "SKIP  " << name.str() << ": p(n) overflows long double" << std::endl;
+                break;
+            }
+        }
+
+        std::string method_name = method == 0 ? "pdc" : "sparse";
+        CheckLarge(method_name, name.str() + ", largest part", all_largest, pmf, gumbel_mean, gumbel_deviation, options, tally);
+        CheckLarge(method_name, name.str() + ", parts", all_parts, pmf, gumbel_mean, gumbel_deviation, options, tally);
+    }
+
+    std::ostringstream distinct_name;
+    distinct_name << "Distinct, n=" << n << ", parts";
+
+    IP::Sampler< IP::Unrestricted<>, ull, ull, IP::DistinctParts > distinct(n);
+    IP::SparseSampler< IP::Unrestricted<>, ull, ull, IP::DistinctParts > distinct_sparse(n);
+    std::vector<long double> distinct_pmf = DistinctPartsDistribution(n);
+
+    // Erdos-Lehner: the number of distinct parts is normal with these moments, from the Boltzmann model at x = exp(-pi/sqrt(12 n)).
+    double inverse_tilt = std::sqrt(12.0*n)/pi;
+    double normal_mean = inverse_tilt*std::log(2.0), normal_deviation = std::sqrt(inverse_tilt*(0.5 - 6*std::log(2.0)*std::log(2.0)/(pi*pi)));
+
+    for(int method=0; method<2; ++method) {
+        std::vector< std::vector<ull> > parts(options.threads);
+        auto record = [&](unsigned t, const IP::PartitionBatch<>& batch) { parts[t].push_back(batch.NumberOfParts(0)); };
+        if(method == 0)
+            Parallel(options.large_samples, options, tally.tests, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { distinct.Draw(batch, gen); }, record);
+        else
+            Parallel(options.large_samples, options, tally.tests, [=](IP::PartitionBatch<>& batch, std::mt19937_64& gen) mutable { distinct_sparse.Draw(batch, gen); }, record);
+
+        std::vector<ull> all;
+        for(auto& v : parts) all.insert(all.end(), v.begin(), v.end());
+        CheckLarge(method == 0 ? "pdc" : "sparse", distinct_name.str(), all, distinct_pmf, normal_mean, normal_deviation, options, tally);
+    }
+}
+
+/** Draws one partition of huge_n with a SparseSampler of 128 bit triangular parts and checks its size and parts, see --huge-n. */
+void CheckHugeN(const Options& options, Tally& tally) {
+
+    typedef IP::Triangular<IP::uint128> U;
+    typedef std::chrono::steady_clock Clock;
+    const U u;
+    const IP::uint128 n = options.huge_n;
+
+    std::ostringstream name;
+    name << "Triangular<uint128>, n=" << IP::ToString(n);
+
+    std::seed_seq seq{ (std::uint32_t)options.seed, (std::uint32_t)tally.tests };
+    std::mt19937_64 gen(seq);
+    IP::PartitionBatch<IP::uint128, IP::uint128> batch;
+
+    Clock::time_point start = Clock::now();
+    IP::SparseSampler<U, IP::uint128> sampler(n, u);
+    Clock::time_point solved = Clock::now();
+    std::string error;
+    try {
+        sampler.Draw(batch, gen);
+    }
+    catch(std::runtime_error& e) {
+        error = e.what();
+    }
+    Clock::time_point drawn = Clock::now();
+
+    IP::uint128 size = 0;
+    bool triangular = true;
+    const std::vector<IP::uint128>& parts = batch.PartArray();
+    const std::vector<IP::uint128>& multiplicities = batch.MultiplicityArray();
+    for(size_t k=0; k<parts.size(); ++k) {
+        size += parts[k]*multiplicities[k];
+        triangular = triangular && u(IP::Inverse(u, parts[k])) == parts[k];
+    }
+
+    bool pass = error.empty() && size == n && triangular;
+    ++tally.tests;
+    tally.failed += !pass;
+
+    std::cout << (pass ? "PASS  " : "FAIL  ") << std::left << std::setw(12) << "sparse" << std::setw(30) << name.str() << std::right;
+    if(!error.empty())
+        std::cout << " " << error << std::endl;
+    else
+        std::cout << " size " << (size == n ? "exact" : "WRONG") << ", parts " << (triangular ? "triangular" : "NOT TRIANGULAR")
+                  << ", " << parts.size() << " distinct, " << sampler.Trials() << " trials" << std::fixed << std::setprecision(2)
+                  << ", solve " << std::chrono::duration<double>(solved - start).count() << " s, draw "
+                  << std::chrono::duration<double>(drawn - solved).count() << " s" << std::endl;
+}
+
+
+void Usage(std::ostream& out) {
+    out << "usage: validate [options]\n"
+           "  --samples N         samples per method at small n, default 10^6\n"
+           "  --max-cells N       largest number of partitions enumerated, default 300\n"
+           "  --large-n N         size of the large n checks, default 10^5\n"
+           "  --large-samples N   samples per method at large n, default 1000\n"
+           "  --huge-n N          draw one partition of N into triangular parts with 128 bit sizes, default 0, none\n"
+           "  --threads N         default: all cores\n"
+           "  --seed N            default 2015\n"
+           "  --alpha A           p-value below which a test fails, default 10^-4\n"
+           "  --quick             --samples 100000 --large-n 10000 --large-samples 200\n";
+}
+
+int main(int argc, const char * argv[]) {
+
+    Options options;
+    try {
+        for(int k=1; k<argc; ++k) {
+            std::string arg = argv[k];
+            if(arg == "-h" || arg == "--help") { Usage(std::cout); return 0; }
+            if(arg == "--quick") {
+                options.samples = 100000;
+                options.large_n = 10000;
+                options.large_samples = 200;
+                continue;
+            }
+            if(k+1 >= argc) throw std::invalid_argument("missing value for " + arg);
+            std::string value = argv[++k];
+            if(arg == "--samples") options.samples = std::stoull(value);
+            else if(arg == "--max-cells") options.max_cells = std::stoull(value);
+            else if(arg == "--large-n") options.large_n = std::stoull(value);
+            else if(arg == "--large-samples") options.large_samples = std::stoull(value);
+            else if(arg == "--huge-n") options.huge_n = std::stoull(value);
+            else if(arg == "--threads") options.threads = std::max(1ul, std::stoul(value));
+            else if(arg == "--seed") options.seed = std::stoull(value);
+            else if(arg == "--alpha") options.alpha = std::stod(value);
+            else throw std::invalid_argument("unexpected argument " + arg);
+        }
+    }
+    catch(std::exception& e) {
+        std::cerr << "validate: " << e.what() << "\n";
+        Usage(std::cerr);
+        return 100;
+    }
+
+    Tally tally;
+    try {
+        CheckPolicy<IP::UnboundedMultiplicity>("Unrestricted", IP::Unrestricted<>(), options, tally);
+        CheckPolicy<IP::UnboundedMultiplicity>("Even", IP::Even<>(), options, tally);
+        CheckPolicy<IP::UnboundedMultiplicity>("Odd", IP::Odd<>(), options, tally);
+        CheckPolicy<IP::UnboundedMultiplicity>("Triangular", IP::Triangular<>(), options, tally);
+        CheckPolicy<IP::UnboundedMultiplicity>("JmodM<1,4>", IP::JmodM<ull,1,4>(), options, tally);
+        CheckPolicy<IP::UnboundedMultiplicity>("PartSet{1,5,10,25}", IP::PartSet<>({1, 5, 10, 25}), options, tally);
+        CheckPolicy<IP::DistinctParts>("Unrestricted, distinct", IP::Unrestricted<>(), options, tally);
+        CheckPolicy<IP::DistinctParts>("Odd, distinct", IP::Odd<>(), options, tally);
+        CheckPolicy< IP::BoundedMultiplicity<2> >("Unrestricted, at most 2 each", IP::Unrestricted<>(), options, tally);
+        CheckBox(20, 6, 7, options, tally);
+        CheckBox(30, 6, 7, options, tally);
+        CheckLargeN(options, tally);
+        if(options.huge_n)
+            CheckHugeN(options, tally);
+    }
+    catch(std::exception& e) {
+        std::cerr << "validate: " << e.what() << "\n";
+        return 100;
+    }
+
+    std::cout << tally.failed << " of " << tally.tests << " tests failed at alpha = " << options.alpha << std::endl;
+    return (int)std::min(100u, tally.failed);
+}